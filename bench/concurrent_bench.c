@@ -0,0 +1,415 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "../src/list.h"
+#include "../src/blocking_queue.h"
+#include "../src/ws_deque.h"
+#include "../src/rcu_list.h"
+
+
+/**
+ * Runs the workloads over the given thread counts, against a List behind a mutex as the baseline,
+ * and the concurrent collections, printing the throughput and the latency percentiles as CSV:
+ *
+ *  ./bench_concurrent.o 1,2,4,8 200
+ *
+ * producer_consumer: half of the threads produce, the others consume, a single thread does both in turns
+ * read_mostly: every thread searches the list, and replaces an item in 1% of the operations
+ * mixed: the same, with half of the operations replacing
+ */
+
+
+#define MAX_THREADS 256
+#define SAMPLES 65536
+/** Every nth operation is timed, so reading the clock doesn't dominate the short ones */
+#define SAMPLE_EVERY 8
+#define QUEUE_LIMIT 65536
+#define LIST_SIZE 256
+
+
+typedef struct Bench Bench;
+
+typedef struct {
+    Bench *bench;
+    unsigned id;
+    uint64_t ops;
+    uint64_t seed;
+    uint32_t *latencies;
+    size_t recorded;
+    RcuReader *reader;
+} Worker;
+
+/** Returns false if there was nothing to do, like an empty queue, that's not counted */
+typedef bool (*Operation)(Worker *);
+
+struct Bench {
+    const char *workload;
+    const char *structure;
+    unsigned threads;
+    unsigned write_percent;
+    bool stop;
+    pthread_barrier_t start;
+    pthread_mutex_t lock;
+    List *list;
+    BlockingQueue *queue;
+    WsDeque *deques[MAX_THREADS];
+    RcuList *rcu;
+    Operation produce;
+    Operation consume;
+    Operation access;
+};
+
+
+static int ITEMS[QUEUE_LIMIT];
+
+
+static uint64_t now_ns(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return (uint64_t) time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+static uint64_t next_random(Worker *worker)
+{
+    worker->seed ^= worker->seed << 13;
+    worker->seed ^= worker->seed >> 7;
+    worker->seed ^= worker->seed << 17;
+
+    return worker->seed;
+}
+
+static bool is_producer(Worker *worker)
+{
+    return worker->id < (worker->bench->threads + 1) / 2;
+}
+
+static void *item_of(Worker *worker)
+{
+    return &ITEMS[next_random(worker) % QUEUE_LIMIT];
+}
+
+static bool list_produce(Worker *worker)
+{
+    Bench *bench = worker->bench;
+    bool added = false;
+
+    pthread_mutex_lock(&bench->lock);
+    if (bench->list->count < QUEUE_LIMIT) {
+        bench->list->append(bench->list, item_of(worker));
+        added = true;
+    }
+    pthread_mutex_unlock(&bench->lock);
+
+    return added;
+}
+
+static bool list_consume(Worker *worker)
+{
+    Bench *bench = worker->bench;
+    void *item;
+
+    pthread_mutex_lock(&bench->lock);
+    item = bench->list->shift(bench->list);
+    pthread_mutex_unlock(&bench->lock);
+
+    return NULL != item;
+}
+
+static bool queue_produce(Worker *worker)
+{
+    return worker->bench->queue->try_push(worker->bench->queue, item_of(worker));
+}
+
+static bool queue_consume(Worker *worker)
+{
+    return NULL != worker->bench->queue->shift_wait(worker->bench->queue, 1);
+}
+
+/** Every producer owns a deque, the consumers steal from a random one */
+static bool deque_produce(Worker *worker)
+{
+    WsDeque *deque = worker->bench->deques[worker->id];
+
+    if (deque->count(deque) >= QUEUE_LIMIT) {
+        return false;
+    }
+    deque->append(deque, item_of(worker));
+
+    return true;
+}
+
+static bool deque_consume(Worker *worker)
+{
+    unsigned producers = (worker->bench->threads + 1) / 2;
+    WsDeque *deque = worker->bench->deques[next_random(worker) % producers];
+
+    return NULL != deque->shift(deque);
+}
+
+static bool alternate(Worker *worker)
+{
+    return worker->ops % 2 ? worker->bench->consume(worker) : worker->bench->produce(worker);
+}
+
+static bool is_write(Worker *worker)
+{
+    return next_random(worker) % 100 < worker->bench->write_percent;
+}
+
+static bool matches_key(void *item)
+{
+    return 0 == *(int *) item;
+}
+
+/** Reads search the whole list, writes replace its oldest item */
+static bool list_access(Worker *worker)
+{
+    Bench *bench = worker->bench;
+
+    pthread_mutex_lock(&bench->lock);
+    if (is_write(worker)) {
+        bench->list->shift(bench->list);
+        bench->list->append(bench->list, item_of(worker));
+    } else {
+        bench->list->find(bench->list, matches_key);
+    }
+    pthread_mutex_unlock(&bench->lock);
+
+    return true;
+}
+
+static bool rcu_access(Worker *worker)
+{
+    RcuList *list = worker->bench->rcu;
+
+    /** Every write adds one item and removes one, so the size stays the same as the baseline's */
+    if (is_write(worker)) {
+        list->append(list, item_of(worker));
+        list->shift(list);
+    } else {
+        list->find(list, matches_key);
+    }
+
+    return true;
+}
+
+static void record(Worker *worker, uint64_t latency)
+{
+    worker->latencies[worker->recorded++ % SAMPLES] = latency > UINT32_MAX ? UINT32_MAX : (uint32_t) latency;
+}
+
+static void *run_worker(void *arg)
+{
+    Worker *worker = arg;
+    Bench *bench = worker->bench;
+    Operation operation = bench->access ? bench->access : 1 == bench->threads ? alternate : is_producer(worker) ? bench->produce : bench->consume;
+    uint64_t start, attempts = 0;
+    bool done;
+
+    if (bench->rcu) {
+        worker->reader = bench->rcu->register_reader(bench->rcu);
+    }
+    pthread_barrier_wait(&bench->start);
+    while (!__atomic_load_n(&bench->stop, __ATOMIC_RELAXED)) {
+        if (0 == attempts++ % SAMPLE_EVERY) {
+            start = now_ns();
+            done = operation(worker);
+            if (done) {
+                record(worker, now_ns() - start);
+            }
+        } else {
+            done = operation(worker);
+        }
+        worker->ops += done;
+        if (worker->reader) {
+            rcu_quiescent(worker->reader);
+        }
+    }
+    if (worker->reader) {
+        rcu_offline(worker->reader);
+        bench->rcu->unregister_reader(bench->rcu, worker->reader);
+    }
+
+    return NULL;
+}
+
+static int compare_latencies(const void *a, const void *b)
+{
+    uint32_t first = *(const uint32_t *) a, second = *(const uint32_t *) b;
+
+    return first < second ? -1 : first > second;
+}
+
+static uint32_t percentile(uint32_t *sorted, size_t count, double rank)
+{
+    return count ? sorted[(size_t) (rank * (count - 1))] : 0;
+}
+
+static void report(Bench *bench, Worker *workers, double seconds)
+{
+    uint32_t *all = malloc((size_t) bench->threads * SAMPLES * sizeof(uint32_t));
+    uint64_t ops = 0;
+    size_t count = 0, recorded;
+    unsigned i;
+
+    for (i = 0; i < bench->threads; i++) {
+        ops += workers[i].ops;
+        recorded = workers[i].recorded < SAMPLES ? workers[i].recorded : SAMPLES;
+        memcpy(all + count, workers[i].latencies, recorded * sizeof(uint32_t));
+        count += recorded;
+    }
+    qsort(all, count, sizeof(uint32_t), compare_latencies);
+    printf("%s,%s,%u,%.0f,%u,%u,%u\n", bench->workload, bench->structure, bench->threads, ops / seconds,
+           percentile(all, count, 0.5), percentile(all, count, 0.99), percentile(all, count, 0.999));
+    free(all);
+}
+
+static void run(Bench *bench, unsigned duration_ms)
+{
+    pthread_t threads[MAX_THREADS];
+    Worker workers[MAX_THREADS];
+    struct timespec duration = {duration_ms / 1000, (duration_ms % 1000) * 1000000L};
+    uint64_t start;
+    unsigned i;
+
+    bench->stop = false;
+    pthread_barrier_init(&bench->start, NULL, bench->threads + 1);
+    for (i = 0; i < bench->threads; i++) {
+        workers[i].bench = bench;
+        workers[i].id = i;
+        workers[i].ops = 0;
+        workers[i].seed = 0x9E3779B97F4A7C15ULL * (i + 1);
+        workers[i].latencies = malloc(SAMPLES * sizeof(uint32_t));
+        workers[i].recorded = 0;
+        workers[i].reader = NULL;
+        pthread_create(&threads[i], NULL, run_worker, &workers[i]);
+    }
+    pthread_barrier_wait(&bench->start);
+    start = now_ns();
+    nanosleep(&duration, NULL);
+    __atomic_store_n(&bench->stop, true, __ATOMIC_RELAXED);
+
+    for (i = 0; i < bench->threads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    report(bench, workers, (now_ns() - start) / 1e9);
+    for (i = 0; i < bench->threads; i++) {
+        free(workers[i].latencies);
+    }
+    pthread_barrier_destroy(&bench->start);
+}
+
+static Bench *bench_new(const char *workload, const char *structure, unsigned threads)
+{
+    Bench *bench = calloc(1, sizeof(Bench));
+    bench->workload = workload;
+    bench->structure = structure;
+    bench->threads = threads;
+    pthread_mutex_init(&bench->lock, NULL);
+
+    return bench;
+}
+
+static void bench_free(Bench *bench)
+{
+    unsigned i;
+
+    if (bench->list) {
+        bench->list->free(bench->list);
+    }
+    if (bench->queue) {
+        bench->queue->free(bench->queue);
+    }
+    for (i = 0; i < MAX_THREADS && bench->deques[i]; i++) {
+        bench->deques[i]->free(bench->deques[i]);
+    }
+    if (bench->rcu) {
+        bench->rcu->free(bench->rcu);
+    }
+    pthread_mutex_destroy(&bench->lock);
+    free(bench);
+}
+
+static void producer_consumer(unsigned threads, unsigned duration_ms)
+{
+    Bench *bench;
+    unsigned i;
+
+    bench = bench_new("producer_consumer", "list_mutex", threads);
+    bench->list = list_new();
+    bench->produce = list_produce;
+    bench->consume = list_consume;
+    run(bench, duration_ms);
+    bench_free(bench);
+
+    bench = bench_new("producer_consumer", "blocking_queue", threads);
+    bench->queue = blocking_queue_new(QUEUE_LIMIT);
+    bench->produce = queue_produce;
+    bench->consume = queue_consume;
+    run(bench, duration_ms);
+    bench_free(bench);
+
+    bench = bench_new("producer_consumer", "ws_deque", threads);
+    for (i = 0; i < (threads + 1) / 2; i++) {
+        bench->deques[i] = ws_deque_new(QUEUE_LIMIT);
+    }
+    bench->produce = deque_produce;
+    bench->consume = deque_consume;
+    run(bench, duration_ms);
+    bench_free(bench);
+}
+
+static void shared_access(const char *workload, unsigned write_percent, unsigned threads, unsigned duration_ms)
+{
+    Bench *bench;
+    unsigned i;
+
+    bench = bench_new(workload, "list_mutex", threads);
+    bench->write_percent = write_percent;
+    bench->list = list_new();
+    for (i = 0; i < LIST_SIZE; i++) {
+        bench->list->append(bench->list, &ITEMS[i + 1]);
+    }
+    bench->access = list_access;
+    run(bench, duration_ms);
+    bench_free(bench);
+
+    bench = bench_new(workload, "rcu_list", threads);
+    bench->write_percent = write_percent;
+    bench->rcu = rcu_list_new();
+    for (i = 0; i < LIST_SIZE; i++) {
+        bench->rcu->append(bench->rcu, &ITEMS[i + 1]);
+    }
+    bench->access = rcu_access;
+    run(bench, duration_ms);
+    bench_free(bench);
+}
+
+int main(int argc, char **argv)
+{
+    char *counts = strdup(argc > 1 ? argv[1] : "1,2,4,8"), *count;
+    unsigned duration_ms = argc > 2 ? (unsigned) strtoul(argv[2], NULL, 10) : 200, threads, i;
+
+    for (i = 0; i < QUEUE_LIMIT; i++) {
+        ITEMS[i] = (int) i % 1000 + 1;
+    }
+    printf("workload,structure,threads,ops_per_second,p50_ns,p99_ns,p999_ns\n");
+
+    for (count = strtok(counts, ","); count; count = strtok(NULL, ",")) {
+        threads = (unsigned) strtoul(count, NULL, 10);
+        if (threads < 1 || threads > MAX_THREADS) {
+            fprintf(stderr, "Thread count has to be between 1 and %d\n", MAX_THREADS);
+            return 1;
+        }
+        producer_consumer(threads, duration_ms);
+        shared_access("read_mostly", 1, threads, duration_ms);
+        shared_access("mixed", 50, threads, duration_ms);
+    }
+    free(counts);
+
+    return 0;
+}
@@ -0,0 +1,131 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../src/list.h"
+#include "../src/compact_list.h"
+
+
+/**
+ * Builds a List and a CompactList beyond 2^32 items, to check the counts and the indexes past
+ * the 32-bit limits. The items are the indexes themselves, so only the nodes take memory:
+ * 24 bytes per item for both of them, the List's nodes come from a single bump allocated pool.
+ * The Makefile builds it with COMPACT_LIST_WIDE_INDEX.
+ */
+
+
+static char *POOL;
+static size_t POOL_USED = 0;
+
+
+static void *pool_alloc(size_t size)
+{
+    void *node = POOL + POOL_USED;
+    POOL_USED += size;
+
+    return node;
+}
+
+static void pool_release(void *node)
+{
+    (void) node;
+}
+
+static double now(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+static void *sum(void *total, void *item)
+{
+    *(uint64_t *) total += (uintptr_t) item;
+
+    return total;
+}
+
+static void report(const char *structure, const char *operation, size_t count, double elapsed, uint64_t check)
+{
+    printf("%s,%s,%lu,%.2f,%lu\n", structure, operation, (unsigned long) count, elapsed * 1e9 / count, (unsigned long) check);
+}
+
+/** The index from the end is past the 32-bit limits too, when there are more than 2^32 items */
+static ptrdiff_t far_index(size_t count)
+{
+    return -(ptrdiff_t) (count - count / 4);
+}
+
+static int bench_list(size_t count)
+{
+    double start;
+    uint64_t total = 0;
+    size_t i, expected = count / 4;
+    List *list;
+
+    if (NULL == (POOL = malloc(count * list_node_size()))) {
+        fprintf(stderr, "Not enough memory for %lu nodes\n", (unsigned long) count);
+        return 1;
+    }
+    list_set_allocators(pool_alloc, pool_release, NULL);
+    list = list_new();
+
+    start = now();
+    for (i = 0; i < count; i++) {
+        list->append(list, (void *) (uintptr_t) i);
+    }
+    report("list", "append", list->count, now() - start, list->count);
+
+    start = now();
+    list->fold_l(list, &total, sum);
+    report("list", "fold_l", count, now() - start, total);
+
+    start = now();
+    total = (uintptr_t) list->get(list, far_index(count));
+    report("list", "get", count, now() - start, total);
+
+    list->free(list);
+    list_set_allocators(NULL, NULL, NULL);
+    free(POOL);
+
+    return total == expected ? 0 : 1;
+}
+
+static int bench_compact_list(size_t count)
+{
+    double start;
+    uint64_t total = 0;
+    size_t i, expected = count / 4;
+    CompactList *list = compact_list_new();
+
+    list->reserve(list, count);
+    if (NULL == list->nodes) {
+        fprintf(stderr, "Not enough memory for %lu nodes\n", (unsigned long) count);
+        return 1;
+    }
+
+    start = now();
+    for (i = 0; i < count; i++) {
+        list->append(list, (void *) (uintptr_t) i);
+    }
+    report("compact_list", "append", list->count, now() - start, list->count);
+
+    start = now();
+    list->fold_l(list, &total, sum);
+    report("compact_list", "fold_l", count, now() - start, total);
+
+    start = now();
+    total = (uintptr_t) list->get(list, far_index(count));
+    report("compact_list", "get", count, now() - start, total);
+
+    list->free(list);
+
+    return total == expected ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+    size_t count = argc > 1 ? strtoul(argv[1], NULL, 10) : (1UL << 32) + 1024;
+
+    return bench_list(count) || bench_compact_list(count);
+}
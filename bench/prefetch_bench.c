@@ -0,0 +1,131 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../src/list.h"
+
+
+/**
+ * Traverses a List whose nodes and items are scattered randomly in memory,
+ * the Makefile builds it with and without the traversal prefetching.
+ */
+
+#ifdef LIST_PREFETCH_DISTANCE
+#define DISTANCE LIST_PREFETCH_DISTANCE
+#else
+#define DISTANCE 4
+#endif
+
+#define REPEAT 5
+
+
+static char *POOL;
+static size_t *SLOTS;
+static size_t NEXT_SLOT = 0;
+
+
+static void *scattered_alloc(size_t size)
+{
+    return POOL + SLOTS[NEXT_SLOT++] * size;
+}
+
+static void pool_release(void *node)
+{
+    (void) node;
+}
+
+static void shuffle(size_t *array, size_t count)
+{
+    size_t i, j, tmp;
+
+    for (i = count - 1; i > 0; i--) {
+        j = ((size_t) rand() * RAND_MAX + rand()) % (i + 1);
+        tmp = array[i];
+        array[i] = array[j];
+        array[j] = tmp;
+    }
+}
+
+static double now(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+static void *sum(void *total, void *item)
+{
+    *(long *) total += *(int *) item;
+
+    return total;
+}
+
+/** Some work per item, the CPU can't run far enough ahead to reach the next node's miss by itself */
+static void *checksum(void *total, void *item)
+{
+    long value = *(int *) item;
+    int i;
+
+    for (i = 0; i < 50; i++) {
+        value = value * 31 + i;
+    }
+    *(long *) total += value & 1;
+
+    return total;
+}
+
+static void measure(List *list, const char *name, Fold fold, unsigned flags)
+{
+    double start, best = 0, elapsed;
+    long total;
+    int i;
+
+    list->flags = flags;
+    for (i = 0; i < REPEAT; i++) {
+        total = 0;
+        start = now();
+        list->fold_l(list, &total, fold);
+        elapsed = now() - start;
+        best = 0 == i || elapsed < best ? elapsed : best;
+    }
+    printf("%d,%s,%lu,%.2f,%ld\n", DISTANCE, name, (unsigned long) list->count, best * 1e9 / list->count, total);
+}
+
+int main(int argc, char **argv)
+{
+    size_t count = argc > 1 ? strtoul(argv[1], NULL, 10) : 1 << 22, i;
+    int *items = malloc(count * 64);
+    size_t *item_slots = malloc(count * sizeof(size_t));
+    List *list;
+
+    POOL = malloc(count * list_node_size());
+    SLOTS = malloc(count * sizeof(size_t));
+    for (i = 0; i < count; i++) {
+        SLOTS[i] = item_slots[i] = i;
+    }
+    srand(42);
+    shuffle(SLOTS, count);
+    shuffle(item_slots, count);
+
+    list_set_allocators(scattered_alloc, pool_release, NULL);
+    list = list_new();
+    for (i = 0; i < count; i++) {
+        /** Items are a cache line apart, so each of them is a separate miss */
+        int *item = items + item_slots[i] * 16;
+        *item = (int) i;
+        list->append(list, item);
+    }
+
+    measure(list, "sum", sum, 0);
+    measure(list, "sum_prefetch_items", sum, LIST_PREFETCH_ITEMS);
+    measure(list, "checksum", checksum, 0);
+    measure(list, "checksum_prefetch_items", checksum, LIST_PREFETCH_ITEMS);
+
+    list->free(list);
+    free(POOL);
+    free(SLOTS);
+    free(items);
+    free(item_slots);
+
+    return 0;
+}
@@ -0,0 +1,235 @@
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include "blocking_queue.h"
+#include "list_internal.h"
+
+
+static bool is_full(BlockingQueue *queue)
+{
+    return queue->capacity && queue->items->count >= queue->capacity;
+}
+
+static bool is_empty(BlockingQueue *queue)
+{
+    return 0 == queue->items->count;
+}
+
+static void deadline_of(long timeout, struct timespec *deadline)
+{
+    clock_gettime(CLOCK_MONOTONIC, deadline);
+    deadline->tv_sec += timeout / 1000;
+    deadline->tv_nsec += (timeout % 1000) * 1000000;
+
+    if (deadline->tv_nsec >= 1000000000) {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000;
+    }
+}
+
+/** Returns false on timeout, the lock has to be held */
+static bool wait_for(BlockingQueue *queue, pthread_cond_t *condition, unsigned *waiting, bool (*blocked)(BlockingQueue *), long timeout)
+{
+    struct timespec deadline;
+    int result = 0;
+
+    if (0 == timeout) {
+        return !blocked(queue);
+    }
+    if (QUEUE_FOREVER != timeout) {
+        deadline_of(timeout, &deadline);
+    }
+    (*waiting)++;
+    while (blocked(queue) && 0 == result) {
+        if (QUEUE_FOREVER == timeout) {
+            pthread_cond_wait(condition, &queue->lock);
+        } else {
+            result = pthread_cond_timedwait(condition, &queue->lock, &deadline);
+        }
+    }
+    (*waiting)--;
+
+    return !blocked(queue);
+}
+
+/** Only the transitions between empty and non-empty cost a syscall */
+static void notify_ready(BlockingQueue *queue)
+{
+    uint64_t one = 1;
+    ssize_t written = write(queue->event_fd, &one, sizeof(one));
+
+    (void) written;
+}
+
+static void clear_ready(BlockingQueue *queue)
+{
+    uint64_t value;
+    ssize_t consumed = read(queue->event_fd, &value, sizeof(value));
+
+    (void) consumed;
+}
+
+/** The lock has to be held, the consumers are only signaled if someone waits */
+static void pushed(BlockingQueue *queue, size_t before, size_t n)
+{
+    if (0 == before) {
+        notify_ready(queue);
+    }
+    if (queue->waiting_consumers) {
+        if (n > 1) {
+            pthread_cond_broadcast(&queue->not_empty);
+        } else {
+            pthread_cond_signal(&queue->not_empty);
+        }
+    }
+}
+
+static void shifted(BlockingQueue *queue, size_t n)
+{
+    if (0 == queue->items->count) {
+        clear_ready(queue);
+    }
+    if (queue->waiting_producers) {
+        if (n > 1) {
+            pthread_cond_broadcast(&queue->not_full);
+        } else {
+            pthread_cond_signal(&queue->not_full);
+        }
+    }
+}
+
+static bool push(BlockingQueue *queue, void *item, long timeout)
+{
+    pthread_mutex_lock(&queue->lock);
+    if (!wait_for(queue, &queue->not_full, &queue->waiting_producers, is_full, timeout)) {
+        pthread_mutex_unlock(&queue->lock);
+        return false;
+    }
+    queue->items->append(queue->items, item);
+    pushed(queue, queue->items->count - 1, 1);
+    pthread_mutex_unlock(&queue->lock);
+
+    return true;
+}
+
+static bool try_push(BlockingQueue *queue, void *item)
+{
+    return push(queue, item, 0);
+}
+
+/**
+ * Pushes as many items at once, as the free capacity allows, the timeout applies to each wait
+ * for capacity. Returns the number of pushed items, it's less than n only on timeout.
+ */
+static size_t push_n(BlockingQueue *queue, void **items, size_t n, long timeout)
+{
+    size_t done = 0, batch, before;
+
+    pthread_mutex_lock(&queue->lock);
+    while (done < n && wait_for(queue, &queue->not_full, &queue->waiting_producers, is_full, timeout)) {
+        before = queue->items->count;
+        batch = n - done;
+        if (queue->capacity && batch > queue->capacity - before) {
+            batch = queue->capacity - before;
+        }
+        queue->items->append_n(queue->items, items + done, batch);
+        pushed(queue, before, batch);
+        done += batch;
+    }
+    pthread_mutex_unlock(&queue->lock);
+
+    return done;
+}
+
+static void *shift_wait(BlockingQueue *queue, long timeout)
+{
+    void *item = NULL;
+
+    pthread_mutex_lock(&queue->lock);
+    /** Detached without releasing the item, that belongs to the consumer now */
+    if (wait_for(queue, &queue->not_empty, &queue->waiting_consumers, is_empty, timeout)) {
+        queue->items->shift_n(queue->items, &item, 1);
+        shifted(queue, 1);
+    }
+    pthread_mutex_unlock(&queue->lock);
+
+    return item;
+}
+
+/** Waits for at least one item, then takes up to max of them with one lock acquisition */
+static size_t drain(BlockingQueue *queue, void **out, size_t max, long timeout)
+{
+    size_t n = 0;
+
+    pthread_mutex_lock(&queue->lock);
+    if (wait_for(queue, &queue->not_empty, &queue->waiting_consumers, is_empty, timeout)) {
+        n = queue->items->shift_n(queue->items, out, max);
+        shifted(queue, n);
+    }
+    pthread_mutex_unlock(&queue->lock);
+
+    return n;
+}
+
+static void *try_shift(BlockingQueue *queue)
+{
+    return shift_wait(queue, 0);
+}
+
+static size_t count(BlockingQueue *queue)
+{
+    size_t count;
+
+    pthread_mutex_lock(&queue->lock);
+    count = queue->items->count;
+    pthread_mutex_unlock(&queue->lock);
+
+    return count;
+}
+
+/** Nobody can wait on it anymore, the remaining items are released by the List */
+static void free_(BlockingQueue *queue)
+{
+    queue->items->free(queue->items);
+    close(queue->event_fd);
+    pthread_cond_destroy(&queue->not_empty);
+    pthread_cond_destroy(&queue->not_full);
+    pthread_mutex_destroy(&queue->lock);
+    free(queue);
+}
+
+/** Returns NULL if the eventfd can't be created */
+BlockingQueue *blocking_queue_new(size_t capacity)
+{
+    BlockingQueue *queue = malloc(sizeof(BlockingQueue));
+    pthread_condattr_t attributes;
+
+    queue->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (queue->event_fd < 0) {
+        free(queue);
+        return NULL;
+    }
+    queue->items = list_new();
+    queue->capacity = capacity;
+    queue->waiting_consumers = queue->waiting_producers = 0;
+    pthread_mutex_init(&queue->lock, NULL);
+
+    /** The timeouts shouldn't depend on the wall clock */
+    pthread_condattr_init(&attributes);
+    pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+    pthread_cond_init(&queue->not_empty, &attributes);
+    pthread_cond_init(&queue->not_full, &attributes);
+    pthread_condattr_destroy(&attributes);
+
+    queue->push = push;
+    queue->try_push = try_push;
+    queue->shift_wait = shift_wait;
+    queue->try_shift = try_shift;
+    queue->push_n = push_n;
+    queue->drain = drain;
+    queue->count = count;
+    queue->free = free_;
+
+    return queue;
+}
@@ -0,0 +1,44 @@
+#ifndef ROGUE_CRAFT_BLOCKING_QUEUE_H
+#define ROGUE_CRAFT_BLOCKING_QUEUE_H
+
+
+#include <pthread.h>
+#include "list.h"
+
+
+/** Timeout for waiting without a limit, the others are in milliseconds, 0 doesn't wait at all */
+#define QUEUE_FOREVER -1
+
+
+typedef struct BlockingQueue BlockingQueue;
+
+/**
+ * Thread safe FIFO queue on a List, consumers can sleep until an item arrives, and producers until
+ * there is free capacity. The event_fd is readable while the queue is not empty, so it can be
+ * added to an epoll loop, it's only written when the queue becomes non-empty, not for every item.
+ */
+struct BlockingQueue {
+    List *items;
+    size_t capacity;
+    int event_fd;
+    unsigned waiting_consumers;
+    unsigned waiting_producers;
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    bool (*push)(BlockingQueue *, void *, long timeout);
+    bool (*try_push)(BlockingQueue *, void *);
+    void *(*shift_wait)(BlockingQueue *, long timeout);
+    void *(*try_shift)(BlockingQueue *);
+    size_t (*push_n)(BlockingQueue *, void **items, size_t n, long timeout);
+    size_t (*drain)(BlockingQueue *, void **out, size_t max, long timeout);
+    size_t (*count)(BlockingQueue *);
+    void (*free)(BlockingQueue *);
+};
+
+
+/** With 0 capacity it's unbounded, pushing never blocks, returns NULL if the eventfd can't be created */
+BlockingQueue *blocking_queue_new(size_t capacity);
+
+
+#endif
@@ -0,0 +1,331 @@
+#include <stdlib.h>
+#include "compact_list.h"
+
+
+#define INITIAL_CAPACITY 16
+
+
+#define compact_walk(list, from, direction, ...)            \
+        CompactIndex index = list->from##_index;            \
+        CompactNode *node;                                  \
+        while (COMPACT_NIL != index) {                      \
+            node = &list->nodes[index];                     \
+            __VA_ARGS__;                                    \
+            index = node->direction;                        \
+        }                                                   \
+
+
+static CompactList *reserve(CompactList *list, CompactIndex capacity)
+{
+    if (capacity > list->capacity) {
+        list->nodes = realloc(list->nodes, (size_t) capacity * sizeof(CompactNode));
+        list->capacity = capacity;
+    }
+
+    return list;
+}
+
+/** Recycled slots are reused first, the array only grows when there is none, returns COMPACT_NIL if it's full */
+static CompactIndex slot_new(CompactList *list, void *value)
+{
+    CompactIndex index = list->free_index;
+
+    if (COMPACT_NIL != index) {
+        list->free_index = list->nodes[index].next;
+    } else {
+        if (COMPACT_NIL == list->used) {
+            return COMPACT_NIL;
+        }
+        if (list->used == list->capacity) {
+            reserve(list, list->capacity <= COMPACT_NIL / 2 ? list->capacity * 2 : COMPACT_NIL);
+        }
+        index = list->used++;
+    }
+    list->nodes[index].value = value;
+
+    return index;
+}
+
+static void slot_free(CompactList *list, CompactIndex index)
+{
+    if (list->release_item) {
+        list->release_item(list->nodes[index].value);
+    }
+    list->nodes[index].next = list->free_index;
+    list->free_index = index;
+}
+
+static void unlink_index(CompactList *list, CompactIndex index)
+{
+    CompactNode *node = &list->nodes[index];
+
+    if (COMPACT_NIL != node->prev) {
+        list->nodes[node->prev].next = node->next;
+    } else {
+        list->head_index = node->next;
+    }
+    if (COMPACT_NIL != node->next) {
+        list->nodes[node->next].prev = node->prev;
+    } else {
+        list->last_index = node->prev;
+    }
+    list->count--;
+}
+
+static void *remove_index(CompactList *list, CompactIndex index)
+{
+    void *value = list->nodes[index].value;
+
+    unlink_index(list, index);
+    slot_free(list, index);
+
+    return value;
+}
+
+static CompactList *prepend(CompactList *list, void *value)
+{
+    CompactIndex index = slot_new(list, value);
+    CompactNode *node;
+
+    if (COMPACT_NIL == index) {
+        return list;
+    }
+    node = &list->nodes[index];
+    node->prev = COMPACT_NIL;
+    node->next = list->head_index;
+
+    if (COMPACT_NIL != list->head_index) {
+        list->nodes[list->head_index].prev = index;
+    } else {
+        list->last_index = index;
+    }
+    list->head_index = index;
+    list->count++;
+
+    return list;
+}
+
+static CompactList *append(CompactList *list, void *value)
+{
+    CompactIndex index = slot_new(list, value);
+    CompactNode *node;
+
+    if (COMPACT_NIL == index) {
+        return list;
+    }
+    node = &list->nodes[index];
+    node->next = COMPACT_NIL;
+    node->prev = list->last_index;
+
+    if (COMPACT_NIL != list->last_index) {
+        list->nodes[list->last_index].next = index;
+    } else {
+        list->head_index = index;
+    }
+    list->last_index = index;
+    list->count++;
+
+    return list;
+}
+
+static void *shift(CompactList *list)
+{
+    return COMPACT_NIL != list->head_index ? remove_index(list, list->head_index) : NULL;
+}
+
+static void *pop(CompactList *list)
+{
+    return COMPACT_NIL != list->last_index ? remove_index(list, list->last_index) : NULL;
+}
+
+static void *head(CompactList *list)
+{
+    return COMPACT_NIL != list->head_index ? list->nodes[list->head_index].value : NULL;
+}
+
+static void *end(CompactList *list)
+{
+    return COMPACT_NIL != list->last_index ? list->nodes[list->last_index].value : NULL;
+}
+
+static CompactList *foreach_l(CompactList *list, Foreach foreach)
+{
+    compact_walk(list, head, next, foreach(node->value));
+
+    return list;
+}
+
+static CompactList *foreach_r(CompactList *list, Foreach foreach)
+{
+    compact_walk(list, last, prev, foreach(node->value));
+
+    return list;
+}
+
+static CompactList *map(CompactList *list, Map mapper)
+{
+    compact_walk(list, head, next, node->value = mapper(node->value));
+
+    return list;
+}
+
+static void *fold_l(CompactList *list, void *value, Fold fold)
+{
+    compact_walk(list, head, next, value = fold(value, node->value));
+
+    return value;
+}
+
+static void *fold_r(CompactList *list, void *value, Fold fold)
+{
+    compact_walk(list, last, prev, value = fold(value, node->value));
+
+    return value;
+}
+
+/** Walks from the closer end */
+static CompactIndex index_at(CompactList *list, ptrdiff_t position)
+{
+    int64_t i = position < 0 ? (int64_t) list->count + position : position;
+
+    if (i < 0 || i >= (int64_t) list->count) {
+        return COMPACT_NIL;
+    }
+    if (i < (int64_t) list->count / 2) {
+        compact_walk(list, head, next, if (0 == i--) return index);
+    } else {
+        i = (int64_t) list->count - 1 - i;
+        compact_walk(list, last, prev, if (0 == i--) return index);
+    }
+
+    return COMPACT_NIL;
+}
+
+static void *get(CompactList *list, ptrdiff_t position)
+{
+    CompactIndex index = index_at(list, position);
+
+    return COMPACT_NIL != index ? list->nodes[index].value : NULL;
+}
+
+static CompactList *set(CompactList *list, ptrdiff_t position, void *value)
+{
+    CompactIndex index = index_at(list, position);
+
+    if (COMPACT_NIL != index) {
+        list->nodes[index].value = value;
+    }
+
+    return list;
+}
+
+static CompactList *delete_at(CompactList *list, ptrdiff_t position)
+{
+    CompactIndex index = index_at(list, position);
+
+    if (COMPACT_NIL != index) {
+        remove_index(list, index);
+    }
+
+    return list;
+}
+
+static CompactList *delete(CompactList *list, void *item)
+{
+    compact_walk(list, head, next,
+                 if (item == node->value) {
+                     remove_index(list, index);
+                     break;
+                 }
+    )
+
+    return list;
+}
+
+static void *find(CompactList *list, Predicate predicate)
+{
+    compact_walk(list, head, next,
+                 if (predicate(node->value)) return node->value;
+    )
+
+    return NULL;
+}
+
+static bool exists(CompactList *list, Predicate predicate)
+{
+    compact_walk(list, head, next,
+                 if (predicate(node->value)) return true;
+    )
+
+    return false;
+}
+
+static bool has(CompactList *list, void *searched)
+{
+    compact_walk(list, head, next,
+                 if (searched == node->value) return true;
+    )
+
+    return false;
+}
+
+static CompactList *filter(CompactList *list, Predicate predicate)
+{
+    CompactIndex index = list->head_index, next;
+
+    while (COMPACT_NIL != index) {
+        next = list->nodes[index].next;
+        if (!predicate(list->nodes[index].value)) {
+            remove_index(list, index);
+        }
+        index = next;
+    }
+
+    return list;
+}
+
+static void free_(CompactList *list)
+{
+    if (list->release_item) {
+        compact_walk(list, head, next, list->release_item(node->value));
+    }
+    free(list->nodes);
+    free(list);
+}
+
+CompactList *compact_list_new(void)
+{
+    CompactList *list = malloc(sizeof(CompactList));
+    list->nodes = NULL;
+    list->capacity = 0;
+    list->used = 0;
+    list->free_index = COMPACT_NIL;
+    list->head_index = COMPACT_NIL;
+    list->last_index = COMPACT_NIL;
+    list->count = 0;
+    list->prepend = prepend;
+    list->shift = shift;
+    list->append = append;
+    list->pop = pop;
+    list->head = head;
+    list->last = end;
+    list->foreach_l = foreach_l;
+    list->foreach_r = foreach_r;
+    list->map = map;
+    list->filter = filter;
+    list->fold_l = fold_l;
+    list->fold_r = fold_r;
+    list->get = get;
+    list->set = set;
+    list->has = has;
+    list->exists = exists;
+    list->find = find;
+    list->delete_at = delete_at;
+    list->delete = delete;
+    list->reserve = reserve;
+    list->free = free_;
+    list->release_item = NULL;
+    reserve(list, INITIAL_CAPACITY);
+
+    return list;
+}
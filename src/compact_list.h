@@ -0,0 +1,66 @@
+#ifndef ROGUE_CRAFT_COMPACT_LIST_H
+#define ROGUE_CRAFT_COMPACT_LIST_H
+
+
+#include "list.h"
+
+
+/** Defining it lifts the limit of 2^32 - 1 elements, for 24 bytes per element instead of 16 */
+#ifdef COMPACT_LIST_WIDE_INDEX
+typedef uint64_t CompactIndex;
+#define COMPACT_NIL UINT64_MAX
+#else
+typedef uint32_t CompactIndex;
+#define COMPACT_NIL UINT32_MAX
+#endif
+
+typedef struct CompactNode CompactNode;
+typedef struct CompactList CompactList;
+
+/**
+ * 16 bytes per element on 64-bit, all of them stored in a single growable array,
+ * the links are indexes into it
+ */
+struct CompactNode {
+    CompactIndex next;
+    CompactIndex prev;
+    void *value;
+};
+
+struct CompactList {
+    CompactNode *nodes;
+    CompactIndex capacity;
+    CompactIndex used;
+    CompactIndex free_index;
+    CompactIndex head_index;
+    CompactIndex last_index;
+    CompactIndex count;
+    CompactList *(*prepend)(CompactList *, void *);
+    void *(*shift)(CompactList *);
+    CompactList *(*append)(CompactList *, void *);
+    void *(*pop)(CompactList *);
+    void *(*head)(CompactList *);
+    void *(*last)(CompactList *);
+    CompactList *(*foreach_l)(CompactList *, Foreach);
+    CompactList *(*foreach_r)(CompactList *, Foreach);
+    CompactList *(*map)(CompactList *, Map);
+    CompactList *(*filter)(CompactList *, Predicate);
+    void *(*fold_l)(CompactList *, void *, Fold);
+    void *(*fold_r)(CompactList *, void *, Fold);
+    void *(*get)(CompactList *, ptrdiff_t);
+    CompactList *(*set)(CompactList *, ptrdiff_t, void *);
+    bool (*has)(CompactList *, void *);
+    bool (*exists)(CompactList *, Predicate);
+    void *(*find)(CompactList *, Predicate);
+    CompactList *(*delete_at)(CompactList *, ptrdiff_t);
+    CompactList *(*delete)(CompactList *, void *);
+    CompactList *(*reserve)(CompactList *, CompactIndex);
+    void (*free)(CompactList *);
+    Release release_item;
+};
+
+
+CompactList *compact_list_new(void);
+
+
+#endif
@@ -0,0 +1,140 @@
+#include <stdlib.h>
+#include "hash_set.h"
+#include "list_internal.h"
+
+
+typedef struct {
+    void *item;
+    void *value;
+    uint64_t hash;
+    bool used;
+} Slot;
+
+struct HashSet {
+    Slot *slots;
+    size_t mask;
+    size_t count;
+    Hash hash;
+    Equals equals;
+};
+
+
+static uint64_t hash_of(HashSet *set, void *item)
+{
+    if (set->hash) {
+        return set->hash(item);
+    }
+    /** Equal items could have different addresses, so without a hash function all of them collide */
+    return set->equals ? 0 : hash_pointer(item);
+}
+
+static Slot *slot_of(HashSet *set, void *item, uint64_t hash)
+{
+    Slot *slot = &set->slots[hash & set->mask];
+
+    while (slot->used) {
+        if (slot->hash == hash && (slot->item == item || (set->equals && set->equals(slot->item, item)))) {
+            break;
+        }
+        slot = &set->slots[(slot - set->slots + 1) & set->mask];
+    }
+
+    return slot;
+}
+
+static Slot *slots_new(size_t size)
+{
+    return calloc(size, sizeof(Slot));
+}
+
+/** Doubles the table, the load factor stays below 0.5 */
+static void grow(HashSet *set)
+{
+    Slot *old = set->slots, *slot;
+    size_t i, size = set->mask + 1;
+
+    set->slots = slots_new(size * 2);
+    set->mask = size * 2 - 1;
+
+    for (i = 0; i < size; i++) {
+        if (old[i].used) {
+            slot = &set->slots[old[i].hash & set->mask];
+            while (slot->used) {
+                slot = &set->slots[(slot - set->slots + 1) & set->mask];
+            }
+            *slot = old[i];
+        }
+    }
+    free(old);
+}
+
+HashSet *hash_set_new(size_t expected, Hash hash, Equals equals)
+{
+    HashSet *set = malloc(sizeof(HashSet));
+    size_t size = 16;
+
+    while (size < expected * 2) {
+        size <<= 1;
+    }
+    set->slots = slots_new(size);
+    set->mask = size - 1;
+    set->count = 0;
+    set->hash = hash;
+    set->equals = equals;
+
+    return set;
+}
+
+void *hash_set_put(HashSet *set, void *item, bool *added)
+{
+    uint64_t hash = hash_of(set, item);
+    Slot *slot = slot_of(set, item, hash);
+
+    if (slot->used) {
+        *added = false;
+        return slot->item;
+    }
+    slot->used = true;
+    slot->item = item;
+    slot->value = NULL;
+    slot->hash = hash;
+    *added = true;
+
+    if (++set->count * 2 > set->mask + 1) {
+        grow(set);
+    }
+
+    return NULL;
+}
+
+void **hash_set_value(HashSet *set, void *item)
+{
+    bool added;
+
+    hash_set_put(set, item, &added);
+
+    return &slot_of(set, item, hash_of(set, item))->value;
+}
+
+void **hash_set_find(HashSet *set, void *item)
+{
+    Slot *slot = slot_of(set, item, hash_of(set, item));
+
+    return slot->used ? &slot->value : NULL;
+}
+
+bool hash_set_has(HashSet *set, void *item)
+{
+    return slot_of(set, item, hash_of(set, item))->used;
+}
+
+size_t hash_set_count(HashSet *set)
+{
+    return set->count;
+}
+
+void hash_set_free(HashSet *set)
+{
+    free(set->slots);
+    free(set);
+}
@@ -0,0 +1,34 @@
+#ifndef ROGUE_CRAFT_HASH_SET_H
+#define ROGUE_CRAFT_HASH_SET_H
+
+/**
+ * Open addressing set of items for the linear time set operations, it can also store a value
+ * for each of them, it's not part of the public API
+ */
+
+#include "list.h"
+
+
+typedef struct HashSet HashSet;
+
+
+/** Without hash and equals functions the items are compared by pointer */
+HashSet *hash_set_new(size_t expected, Hash hash, Equals equals);
+
+/** Returns the item already in the set equal to the given one, or adds it and returns NULL */
+void *hash_set_put(HashSet *set, void *item, bool *added);
+
+/** The value stored along with the item, the item is added with a NULL value if it wasn't in the set */
+void **hash_set_value(HashSet *set, void *item);
+
+/** The value stored along with the item, or NULL if it isn't in the set */
+void **hash_set_find(HashSet *set, void *item);
+
+bool hash_set_has(HashSet *set, void *item);
+
+size_t hash_set_count(HashSet *set);
+
+void hash_set_free(HashSet *set);
+
+
+#endif
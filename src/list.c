@@ -1,21 +1,79 @@
 #include <malloc.h>
 #include <stdlib.h>
-#include "list.h"
+#include <string.h>
+#include <pthread.h>
+#include "list_internal.h"
+#include "reclaimer.h"
+#include "hash_set.h"
+
+
+#if LIST_PREFETCH_DISTANCE > 0
+
+/** Keeps a cursor LIST_PREFETCH_DISTANCE nodes ahead, so its cache misses overlap with the callbacks */
+#define prefetch_init(list, node, direction)                            \
+        Node *ahead = node;                                             \
+        bool prefetch_items = list->flags & LIST_PREFETCH_ITEMS;        \
+        int distance = LIST_PREFETCH_DISTANCE;                          \
+        while (ahead && 0 < distance--) {                               \
+            ahead = ahead->direction;                                   \
+        }                                                               \
+
+#define prefetch_step(direction)                                        \
+        if (ahead) {                                                    \
+            if (prefetch_items) {                                       \
+                __builtin_prefetch(ahead->value);                       \
+            }                                                           \
+            ahead = ahead->direction;                                   \
+            __builtin_prefetch(ahead);                                  \
+        }                                                               \
+
+#else
+
+#define prefetch_init(list, node, direction)
+#define prefetch_step(direction)
+
+#endif
+
+#define node_walk(list, from, direction, ...)                           \
+        Node *node = list->from##_node;                                 \
+        prefetch_init(list, node, direction)                            \
+        while (node) {                                                  \
+            prefetch_step(direction)                                    \
+            __VA_ARGS__;                                                \
+            node = node->direction;                                     \
+        }                                                               \
+
+
+/** Below this many items compacting automatically isn't worth it */
+#define AUTO_COMPACT_MIN 64
+
+/** Freed List headers kept by each thread for the next list_new() */
+#define HEADER_POOL_SIZE 32
+
+/** Links to a node within this distance forward are considered sequential by the fragmentation metric */
+#define NEAR_DISTANCE 256
+
+
+/**
+ * The nodes of a compacted List, in order, in one allocation. It's released when every node in it
+ * and every List referencing it let it go, the nodes can be moved to other Lists too.
+ */
+struct ListBlock {
+    size_t refs;
+    char *start;
+    char *end;
+};
 
 
-#define node_walk(list, from, direction, ...)   \
-        Node *node = list->from##_node;         \
-        while (node) {                          \
-            __VA_ARGS__;                        \
-            node = node->direction;             \
-        }                                       \
+static void compact_point(List *list);
 
 
-struct Node {
-    Node *next;
-    Node *prev;
-    void *value;
-};
+/** The pooled headers are linked through their first bytes */
+static __thread List *HEADER_POOL = NULL;
+static __thread size_t HEADER_POOL_COUNT = 0;
+static __thread bool HEADER_POOL_REGISTERED = false;
+static pthread_key_t HEADER_KEY;
+static pthread_once_t HEADER_KEY_ONCE = PTHREAD_ONCE_INIT;
 
 static Alloc DEFAULT_NODE_ALLOC = malloc;
 static Release DEFAULT_NODE_RELEASE = free;
@@ -24,76 +82,260 @@ static Release DEFAULT_ITEM_RELEASE = NULL;
 
 static void *head(List *list)
 {
-    Node *head = list->head_node;
+    Node *head = end_node(list, true);
 
     return head ? head->value : NULL;
 }
 
 static void *end(List *list)
 {
-    Node *last = list->last_node;
+    Node *last = end_node(list, false);
 
     return last ? last->value : NULL;
 }
 
-static Node *node_new(List *list, Node *prev, Node *next, void *value)
+static Node *node_new(List *list, void *value)
 {
     Node *node = list->alloc_node(sizeof(Node));
-    node->prev = prev;
-    node->next = next;
     node->value = value;
 
     return node;
 }
 
-static void node_free(List *list, Node *node)
+/** The item is copied right after the links, in the same allocation */
+static Node *node_new_copy(List *list, void *value)
 {
-    if (list->release_item) {
-        list->release_item(node->value);
+    Node *node = list->alloc_node(sizeof(Node) + list->item_size);
+    node->value = node + 1;
+    memcpy(node->value, value, list->item_size);
+
+    return node;
+}
+
+static bool node_is_inline(List *list, Node *node)
+{
+    return list->item_size && node->value == (void *) (node + 1);
+}
+
+/** The nodes are one after the other in the block, with the inline items aligned to pointer size */
+static size_t node_stride(List *list)
+{
+    return sizeof(Node) + (list->item_size + sizeof(void *) - 1) / sizeof(void *) * sizeof(void *);
+}
+
+static bool node_in_block(ListBlock *block, Node *node)
+{
+    return block && (char *) node >= block->start && (char *) node < block->end;
+}
+
+static void block_retain(ListBlock *block)
+{
+    if (block) {
+        __sync_fetch_and_add(&block->refs, 1);
     }
-    list->release_node(node);
 }
 
-static void add_first_node(List *list, Node *new)
+/**
+ * Called when the List doesn't reference the block anymore. The block isn't a node, so it's freed
+ * directly, not through the node allocator or the Reclaimer.
+ */
+static void block_leave(List *list)
 {
-    list->head_node = list->last_node = new;
-    new->prev = new->next = NULL;
+    ListBlock *block = list->block;
+
+    list->block = NULL;
+    if (block && 0 == __sync_sub_and_fetch(&block->refs, 1)) {
+        free(block);
+    }
 }
 
-static List *prepend(List *list, void *value)
+void node_dispose(List *list, Node *node)
+{
+    Reclaimer *reclaimer = list->reclaimer;
+
+    list->churn++;
+    if (node_in_block(list->block, node)) {
+        /** The List still references the block, so this can't be the last release */
+        __sync_fetch_and_sub(&list->block->refs, 1);
+    } else if (reclaimer && reclaimer->release_nodes) {
+        reclaimer->defer_node(reclaimer, node);
+    } else {
+        list->release_node(node);
+    }
+}
+
+/** Keeps the node of a removed inline item until the next change, so the returned pointer stays valid */
+static void node_hold(List *list, Node *node)
+{
+    if (node_in_block(list->block, node)) {
+        list->removed_block = list->block;
+    }
+    node->next = list->removed;
+    list->removed = node;
+}
+
+/** The block can be left by the List meanwhile, then the held nodes still keep it alive */
+void list_release_removed(List *list)
+{
+    ListBlock *block = list->removed_block;
+    char *start = block ? block->start : NULL, *end = block ? block->end : NULL;
+    Node *node = list->removed, *next;
+
+    list->removed = NULL;
+    list->removed_block = NULL;
+    for (; node; node = next) {
+        next = node->next;
+        if (block && block != list->block && (char *) node >= start && (char *) node < end) {
+            list->churn++;
+            if (0 == __sync_sub_and_fetch(&block->refs, 1)) {
+                free(block);
+            }
+        } else {
+            node_dispose(list, node);
+        }
+    }
+}
+
+static void node_free(List *list, Node *node)
 {
-    Node *new = node_new(list, NULL, list->head_node, value);
+    Reclaimer *reclaimer = list->reclaimer;
 
-    if (0 < list->count) {
-        list->head_node->prev = new;
-        list->head_node = new;
+    if (list->release_item && !node_is_inline(list, node)) {
+        if (reclaimer && reclaimer->release_items) {
+            reclaimer->defer_item(reclaimer, node->value);
+        } else {
+            list->release_item(node->value);
+        }
+    }
+    node_dispose(list, node);
+}
+
+static void node_link_end(List *list, Node *node, bool front)
+{
+    if (stored_front(list, front)) {
+        node_link_front(list, node);
     } else {
-        add_first_node(list, new);
+        node_link_back(list, node);
     }
-    list->count++;
+}
+
+static Node *prepend_h(List *list, void *value)
+{
+    will_mutate(list);
+
+    Node *new = node_new(list, value);
+    node_link_end(list, new, true);
+
+    return new;
+}
+
+static Node *append_h(List *list, void *value)
+{
+    will_mutate(list);
+
+    Node *new = node_new(list, value);
+    node_link_end(list, new, false);
+
+    return new;
+}
+
+static List *prepend(List *list, void *value)
+{
+    prepend_h(list, value);
 
     return list;
 }
 
 static List *append(List *list, void *value)
 {
-    Node *new = node_new(list, list->last_node, NULL, value);
+    append_h(list, value);
 
-    if (0 < list->count) {
-        list->last_node->next = new;
-        list->last_node = new;
-    } else {
-        add_first_node(list, new);
+    return list;
+}
+
+static List *prepend_copy(List *list, void *value)
+{
+    will_mutate(list);
+
+    node_link_end(list, node_new_copy(list, value), true);
+
+    return list;
+}
+
+static List *append_copy(List *list, void *value)
+{
+    will_mutate(list);
+
+    node_link_end(list, node_new_copy(list, value), false);
+
+    return list;
+}
+
+static List *move_to_front(List *list, Node *node)
+{
+    will_mutate(list);
+
+    if (node != end_node(list, true)) {
+        node_unlink(list, node);
+        node_link_end(list, node, true);
+    }
+
+    return list;
+}
+
+static List *move_to_back(List *list, Node *node)
+{
+    will_mutate(list);
+
+    if (node != end_node(list, false)) {
+        node_unlink(list, node);
+        node_link_end(list, node, false);
+    }
+
+    return list;
+}
+
+/** In the stored order, NULL moves it to the stored last place */
+static List *move_before(List *list, Node *node, Node *before)
+{
+    will_mutate(list);
+
+    if (NULL == before) {
+        if (node != list->last_node) {
+            node_unlink(list, node);
+            node_link_back(list, node);
+        }
+        return list;
+    }
+    if (node != before && node->next != before) {
+        node_unlink(list, node);
+        node_link_before(list, node, before);
     }
-    list->count++;
 
     return list;
 }
 
+/** Unlike delete(), the item is not released, only the node, an inline item is valid until the next change */
+static void *remove_h(List *list, Node *node)
+{
+    void *value = node->value;
+
+    will_mutate(list);
+    node_unlink(list, node);
+    if (node_is_inline(list, node)) {
+        node_hold(list, node);
+    } else {
+        node_dispose(list, node);
+    }
+
+    return value;
+}
+
 static List *replace(List *list, void *from, void *to)
 {
     Node *found = NULL;
 
+    will_mutate(list);
     node_walk(list, head, next,
               if (from == node->value) {
                   found = node;
@@ -106,95 +348,229 @@ static List *replace(List *list, void *from, void *to)
     return list;
 }
 
-static void *remove_end(List *list, Node *node)
+/** An inline item is returned from its node, which is kept until the next change of the List */
+static void *remove_end_of(List *list, bool front)
 {
-    if (node == list->head_node) {
-        list->head_node = node->next;
-    }
-    if (node == list->last_node) {
-        list->last_node = node->prev;
+    Node *node;
+    void *val;
+
+    if (NULL == list->head_node) {
+        return NULL;
     }
+    will_mutate(list);
+    node = end_node(list, front);
+    val = node->value;
 
-    list->count--;
-    void *val = node->value;
-    node_free(list, node);
+    node_unlink(list, node);
+    if (node_is_inline(list, node)) {
+        node_hold(list, node);
+    } else {
+        node_free(list, node);
+    }
+    compact_point(list);
 
     return val;
 }
 
 static void *pop(List *list)
 {
-    if (list->last_node) {
-        Node *tmp = list->last_node;
-        list->last_node = tmp->prev;
+    return remove_end_of(list, false);
+}
 
-        if (tmp->prev) {
-            tmp->prev->next = NULL;
-        }
+static void *shift(List *list)
+{
+    return remove_end_of(list, true);
+}
 
-        return remove_end(list, tmp);
+/** Copies item_size bytes of the item into out, before the node and the item are released */
+static bool remove_copy(List *list, bool front, void *out)
+{
+    Node *node;
+
+    if (0 == list->item_size || NULL == list->head_node) {
+        return false;
     }
+    will_mutate(list);
 
-    return NULL;
+    node = end_node(list, front);
+    memcpy(out, node->value, list->item_size);
+    node_unlink(list, node);
+    node_free(list, node);
+    compact_point(list);
+
+    return true;
 }
 
-static void *shift(List *list)
+static bool shift_copy(List *list, void *out)
+{
+    return remove_copy(list, true, out);
+}
+
+static bool pop_copy(List *list, void *out)
+{
+    return remove_copy(list, false, out);
+}
+
+/** Links the new nodes into a chain first, so the List is only updated once */
+static List *link_n(List *list, void **items, size_t n, bool front)
 {
-    if (list->head_node) {
-        Node *tmp = list->head_node;
-        list->head_node = tmp->next;
+    Node *first = NULL, *last = NULL, *node;
+    bool reversed = list->flags & LIST_REVERSED;
+    size_t i;
 
-        if (tmp->next) {
-            tmp->next->prev = NULL;
+    will_mutate(list);
+    if (0 == n) {
+        return list;
+    }
+    /** The order of the array is kept in the order the List is seen in */
+    front = stored_front(list, front);
+    for (i = 0; i < n; i++) {
+        node = node_new(list, items[reversed ? n - 1 - i : i]);
+        node->prev = last;
+        node->next = NULL;
+        if (last) {
+            last->next = node;
+        } else {
+            first = node;
+        }
+        last = node;
+    }
+    if (front) {
+        last->next = list->head_node;
+        if (list->head_node) {
+            list->head_node->prev = last;
+        } else {
+            list->last_node = last;
         }
+        list->head_node = first;
+    } else {
+        first->prev = list->last_node;
+        if (list->last_node) {
+            list->last_node->next = first;
+        } else {
+            list->head_node = first;
+        }
+        list->last_node = last;
+    }
+    list->count += n;
 
-        return remove_end(list, tmp);
+    return list;
+}
+
+static List *append_n(List *list, void **items, size_t n)
+{
+    return link_n(list, items, n, false);
+}
+
+/** The items keep their order, the first one becomes the head */
+static List *prepend_n(List *list, void **items, size_t n)
+{
+    return link_n(list, items, n, true);
+}
+
+/** Detaches up to n nodes from one end, the List is only updated once, the inline items are valid until the next change */
+static size_t remove_n(List *list, void **out, size_t n, bool front)
+{
+    Node *node, *next;
+    size_t i = 0;
+
+    will_mutate(list);
+    front = stored_front(list, front);
+    node = front ? list->head_node : list->last_node;
+
+    while (node && i < n) {
+        next = front ? node->next : node->prev;
+        out[i++] = node->value;
+        if (node_is_inline(list, node)) {
+            node_hold(list, node);
+        } else {
+            node_dispose(list, node);
+        }
+        node = next;
+    }
+    if (front) {
+        list->head_node = node;
+        if (node) {
+            node->prev = NULL;
+        } else {
+            list->last_node = NULL;
+        }
+    } else {
+        list->last_node = node;
+        if (node) {
+            node->next = NULL;
+        } else {
+            list->head_node = NULL;
+        }
     }
+    list->count -= i;
+    compact_point(list);
 
-    return NULL;
+    return i;
+}
+
+static size_t shift_n(List *list, void **out, size_t n)
+{
+    return remove_n(list, out, n, true);
+}
+
+/** The items are in the order they were popped, starting with the last one */
+static size_t pop_n(List *list, void **out, size_t n)
+{
+    return remove_n(list, out, n, false);
 }
 
 static List *foreach_l(List *list, Foreach foreach)
 {
-    node_walk(list, head, next, foreach(node->value));
+    if (list->flags & LIST_REVERSED) {
+        node_walk(list, last, prev, foreach(node->value));
+    } else {
+        node_walk(list, head, next, foreach(node->value));
+    }
 
     return list;
 }
 
 static List *foreach_r(List *list, Foreach foreach)
 {
-    node_walk(list, last, prev, foreach(node->value));
+    if (list->flags & LIST_REVERSED) {
+        node_walk(list, head, next, foreach(node->value));
+    } else {
+        node_walk(list, last, prev, foreach(node->value));
+    }
 
     return list;
 }
 
 static List *map(List *list, Map mapper)
 {
+    will_mutate(list);
+
     node_walk(list, head, next, node->value = mapper(node->value));
 
     return list;
 }
 
-static Node *node_at(List *list, int index)
+/** Negative indexes count from the end, walks from the nearer one */
+static Node *node_at(List *list, ptrdiff_t index)
 {
-    int i = 0;
+    size_t position;
 
     if (index < 0) {
-        node_walk(list, last, prev,
-                  if (0 == ++index) return node;
-        )
+        if (distance_from_end(index) > list->count) {
+            return NULL;
+        }
+        position = list->count - distance_from_end(index);
     } else {
-        node_walk(list, head, next,
-                  if (i++ == index) return node;
-        )
+        position = (size_t) index;
     }
 
-    return NULL;
+    return position < list->count ? node_near(list, position) : NULL;
 }
 
-static void *get(List *list, int index)
+static void *get(List *list, ptrdiff_t index)
 {
-    Node *node = node_at(list, index);
+    Node *node = node_at(list, stored_index(list, index));
 
     if (node) {
         return node->value;
@@ -202,13 +578,14 @@ static void *get(List *list, int index)
     return NULL;
 }
 
-static List *set(List *list, int index, void *value)
+static List *set(List *list, ptrdiff_t index, void *value)
 {
-    Node *node = node_at(list, index);
+    will_mutate(list);
+
+    Node *node = node_at(list, stored_index(list, index));
 
     if (node) {
         node->value = value;
-        list->count++;
     }
 
     return list;
@@ -217,39 +594,33 @@ static List *set(List *list, int index, void *value)
 static void delete_node(List *list, Node *node)
 {
     if (node) {
-        if (node->prev) {
-            node->prev->next = node->next;
-        }
-        if (node->next) {
-            node->next->prev = node->prev;
-        }
-        if (node == list->head_node) {
-            list->head_node = node->next;
-        }
-        if (node == list->last_node) {
-            list->last_node = node->prev;
-        }
+        node_unlink(list, node);
         node_free(list, node);
-        list->count--;
     }
 }
 
-static List *delete_at(List *list, int index)
+static List *delete_at(List *list, ptrdiff_t index)
 {
-    Node *node = node_at(list, index);
+    will_mutate(list);
+
+    Node *node = node_at(list, stored_index(list, index));
     delete_node(list, node);
+    compact_point(list);
 
     return list;
 }
 
 static List *delete(List *list, void *item)
 {
+    will_mutate(list);
+
     node_walk(list, head, next,
               if (item == node->value) {
                   delete_node(list, node);
                   break;
               }
     )
+    compact_point(list);
 
     return list;
 }
@@ -283,15 +654,21 @@ static bool exists(List *list, Predicate predicate)
 
 static List *filter(List *list, Predicate predicate)
 {
-    Node *node = list->head_node, *next;
+    Node *node, *next;
+
+    will_mutate(list);
+    node = list->head_node;
+    prefetch_init(list, node, next)
 
     while (node) {
+        prefetch_step(next)
         next = node->next;
         if (!predicate(node->value)) {
             delete_node(list, node);
         }
         node = next;
     }
+    compact_point(list);
 
     return list;
 }
@@ -313,17 +690,225 @@ static List *concat_f(List *list, List *other)
     return list;
 }
 
+/** Compares the items of the List as the comparing List would do */
+static HashSet *hash_set_of(List *list, List *comparing, size_t expected)
+{
+    HashSet *set = hash_set_new(expected, comparing->hash, comparing->equals);
+    bool added;
+
+    node_walk(list, head, next, hash_set_put(set, node->value, &added));
+
+    return set;
+}
+
+/** Appends the new items in the order the other List is seen in, like concat */
 static List *merge(List *list, List *other)
 {
+    HashSet *set = hash_set_of(list, list, list->count + other->count);
+    bool added;
+
     other->foreach_l(other, function(void, (void *item) {
-        if (!list->has(list, item)) {
-        list->append(list, item);
-    }
+        hash_set_put(set, item, &added);
+        if (added) {
+            list->append(list, item);
+        }
     }));
+    hash_set_free(set);
+
+    return list;
+}
+
+/** The repeated pointers are only unlinked, their item is still in the List, or it was released already */
+static List *distinct(List *list)
+{
+    HashSet *set = hash_set_new(list->count, list->hash, list->equals), *released = NULL;
+    Node *node, *next;
+    void *existing;
+    bool added;
+
+    will_mutate(list);
+    for (node = list->head_node; node; node = next) {
+        next = node->next;
+        /** A released item can't be compared anymore, its pointer is looked up first */
+        if (released && hash_set_has(released, node->value)) {
+            node_unlink(list, node);
+            node_dispose(list, node);
+            continue;
+        }
+        existing = hash_set_put(set, node->value, &added);
+
+        if (!added) {
+            node_unlink(list, node);
+            if (existing == node->value) {
+                node_dispose(list, node);
+            } else {
+                released = released ? released : hash_set_new(0, NULL, NULL);
+                hash_set_put(released, node->value, &added);
+                node_free(list, node);
+            }
+        }
+    }
+    if (released) {
+        hash_set_free(released);
+    }
+    hash_set_free(set);
+    compact_point(list);
 
     return list;
 }
 
+/** Keeps or deletes the items depending on whether they are in the other List */
+static List *filter_by(List *list, List *other, bool keep)
+{
+    HashSet *set;
+    Node *node, *next;
+
+    will_mutate(list);
+    set = hash_set_of(other, list, other->count);
+
+    for (node = list->head_node; node; node = next) {
+        next = node->next;
+        if (keep != hash_set_has(set, node->value)) {
+            delete_node(list, node);
+        }
+    }
+    hash_set_free(set);
+    compact_point(list);
+
+    return list;
+}
+
+/** An empty List with the same allocators, callbacks and settings */
+static List *list_new_like(List *list)
+{
+    List *new = list_new();
+    new->flags = list->flags;
+    new->item_size = list->item_size;
+    new->alloc_node = list->alloc_node;
+    new->release_node = list->release_node;
+    new->release_item = list->release_item;
+    new->reclaimer = list->reclaimer;
+    new->hash = list->hash;
+    new->equals = list->equals;
+
+    return new;
+}
+
+/** For the nodes relinked from the List, they can be in its block */
+static List *list_new_relinked(List *list)
+{
+    List *new = list_new_like(list);
+    new->block = list->block;
+    block_retain(new->block);
+
+    return new;
+}
+
+/** Moves every node of the List into a group, by relinking them, the List is left empty */
+static List *group_by(List *list, Key key, Hash hash, Equals equals)
+{
+    HashSet *groups = hash_set_new(0, hash, equals);
+    List *result = list_new(), **group;
+    Node *node;
+    void *item_key;
+
+    will_mutate(list);
+    while ((node = list->head_node)) {
+        item_key = key(node->value);
+        group = (List **) hash_set_value(groups, item_key);
+
+        if (NULL == *group) {
+            *group = list_new_relinked(list);
+            result->append(result, *group);
+        }
+        node_unlink(list, node);
+        node_link_back(*group, node);
+    }
+    hash_set_free(groups);
+
+    return result;
+}
+
+/** Moves the items to k new Lists by their bucket index, the ones out of range stay in the List */
+static List **partition_by(List *list, Bucket bucket, size_t k)
+{
+    List **partitions = malloc(k * sizeof(List *));
+    Node *node, *next;
+    size_t i;
+
+    will_mutate(list);
+    for (i = 0; i < k; i++) {
+        partitions[i] = list_new_relinked(list);
+    }
+    for (node = list->head_node; node; node = next) {
+        next = node->next;
+        i = bucket(node->value);
+
+        if (i < k) {
+            node_unlink(list, node);
+            node_link_back(partitions[i], node);
+        }
+    }
+
+    return partitions;
+}
+
+/** Moves the whole chain into a new List in O(1), the List is left empty */
+static List *take_all(List *list)
+{
+    List *new;
+
+    will_mutate(list);
+    new = list_new_relinked(list);
+    new->head_node = list->head_node;
+    new->last_node = list->last_node;
+    new->count = list->count;
+    list->head_node = list->last_node = NULL;
+    list->count = 0;
+
+    return new;
+}
+
+/** Detaches the nodes from the index into a new List by relinking them */
+static List *split_at(List *list, ptrdiff_t index)
+{
+    List *tail;
+    size_t position;
+    Node *first;
+
+    will_mutate(list);
+    tail = list_new_relinked(list);
+    position = position_of(list, index);
+
+    if (position < list->count) {
+        first = node_near(list, position);
+        tail->head_node = first;
+        tail->last_node = list->last_node;
+        tail->count = list->count - position;
+
+        list->last_node = first->prev;
+        if (first->prev) {
+            first->prev->next = NULL;
+        } else {
+            list->head_node = NULL;
+        }
+        first->prev = NULL;
+        list->count = position;
+    }
+
+    return tail;
+}
+
+static List *intersect(List *list, List *other)
+{
+    return filter_by(list, other, true);
+}
+
+static List *difference(List *list, List *other)
+{
+    return filter_by(list, other, false);
+}
+
 static List *merge_f(List *list, List *other)
 {
     list->merge(list, other);
@@ -334,43 +919,376 @@ static List *merge_f(List *list, List *other)
 
 static void *fold_l(List *list, void *value, Fold fold)
 {
-    node_walk(list, head, next, value = fold(value, node->value));
+    if (list->flags & LIST_REVERSED) {
+        node_walk(list, last, prev, value = fold(value, node->value));
+    } else {
+        node_walk(list, head, next, value = fold(value, node->value));
+    }
 
     return value;
 }
 
 static void *fold_r(List *list, void *value, Fold fold)
 {
-    node_walk(list, last, prev, value = fold(value, node->value));
+    if (list->flags & LIST_REVERSED) {
+        node_walk(list, head, next, value = fold(value, node->value));
+    } else {
+        node_walk(list, last, prev, value = fold(value, node->value));
+    }
 
     return value;
 }
 
+/** Swaps the links of every node, the handles stay valid */
+static List *reverse(List *list)
+{
+    Node *node, *next;
+
+    will_mutate(list);
+
+    for (node = list->head_node; node; node = next) {
+        next = node->next;
+        node->next = node->prev;
+        node->prev = next;
+    }
+    node = list->head_node;
+    list->head_node = list->last_node;
+    list->last_node = node;
+
+    return list;
+}
+
+/**
+ * Moves the first k items to the back, or the last -k ones to the front if it's negative, by closing the
+ * chain into a ring, and opening it at the new head, that's found from the nearer end
+ */
+static List *rotate(List *list, ptrdiff_t k)
+{
+    size_t count = list->count, position;
+    Node *head;
+
+    if (count < 2) {
+        return list;
+    }
+    position = k >= 0 ? (size_t) k % count : count - 1 - (size_t) -(k + 1) % count;
+    if (0 == position) {
+        return list;
+    }
+    if (list->flags & LIST_REVERSED) {
+        position = count - position;
+    }
+    will_mutate(list);
+
+    head = node_near(list, position);
+    list->last_node->next = list->head_node;
+    list->head_node->prev = list->last_node;
+    list->head_node = head;
+    list->last_node = head->prev;
+    head->prev = NULL;
+    list->last_node->next = NULL;
+
+    return list;
+}
+
+/** Copies the nodes in order into a single block, so the traversals access the memory sequentially */
+static List *compact(List *list)
+{
+    size_t stride = node_stride(list);
+    ListBlock *block;
+    Node *node, *next, *copy, *prev = NULL;
+    char *slot;
+
+    will_mutate(list);
+    list->churn = 0;
+    if (0 == list->count) {
+        return list;
+    }
+    block = malloc(sizeof(ListBlock) + list->count * stride);
+    block->refs = list->count + 1;
+    block->start = slot = (char *) (block + 1);
+    block->end = block->start + list->count * stride;
+
+    node = list->head_node;
+    prefetch_init(list, node, next)
+
+    while (node) {
+        prefetch_step(next)
+        next = node->next;
+        copy = (Node *) slot;
+        copy->prev = prev;
+        copy->next = NULL;
+        copy->value = node->value;
+
+        if (node_is_inline(list, node)) {
+            copy->value = copy + 1;
+            memcpy(copy->value, node->value, list->item_size);
+        }
+        if (prev) {
+            prev->next = copy;
+        } else {
+            list->head_node = copy;
+        }
+        node_dispose(list, node);
+        prev = copy;
+        slot += stride;
+        node = next;
+    }
+    list->last_node = prev;
+    block_leave(list);
+    list->block = block;
+    list->churn = 0;
+
+    return list;
+}
+
+/** The share of the links, that don't point to a nearby address forward */
+static double fragmentation(List *list)
+{
+    size_t far = 0;
+    ptrdiff_t gap;
+
+    if (list->count < 2) {
+        return 0;
+    }
+    node_walk(list, head, next,
+              if (node->next) {
+                  gap = (char *) node->next - (char *) node;
+                  far += gap <= 0 || gap > NEAR_DISTANCE;
+              }
+    )
+
+    return (double) far / (list->count - 1);
+}
+
+/** A safe point to compact automatically, after the removals of an operation, the held nodes stay in the old block */
+static void compact_point(List *list)
+{
+    Node *removed = list->removed;
+
+    if ((list->flags & LIST_AUTO_COMPACT) && list->count >= AUTO_COMPACT_MIN && list->churn > list->count) {
+        list->removed = NULL;
+        compact(list);
+        list->removed = removed;
+    }
+}
+
+static Node *node_copy(List *list, Node *node, void *unused)
+{
+    (void) unused;
+
+    return node_is_inline(list, node) ? node_new_copy(list, node->value) : node_new(list, node->value);
+}
+
+/** The copy gets the same allocators, callbacks and flags, so the items shouldn't be released by both */
 static List *clone(List *list)
 {
-    List *new = list_new();
+    List *new = list_new_like(list);
 
-    list->foreach_l(list, function(void, (void *item) {
-        new->append(new, item);
-    }));
+    /** Linked in the stored order, the copied flags turn it around the same way */
+    node_walk(list, head, next, node_link_back(new, node_copy(new, node, NULL)));
 
     return new;
 }
 
-static void free_(List *list)
+/**
+ * Shares the nodes, until one of the Lists is modified, the snapshot doesn't own the items. Several
+ * threads can snapshot the same List at once, the first one publishes the share.
+ */
+static List *clone_cow(List *list)
+{
+    List *new = list_new();
+    ListShare *share = __atomic_load_n(&list->share, __ATOMIC_ACQUIRE), *expected = NULL;
+
+    if (NULL == share) {
+        share = malloc(sizeof(ListShare));
+        share->refs = 1;
+        share->owner = list;
+        share->release_item = list->release_item;
+        /** Whoever releases the chain releases the block too */
+        share->block = list->block;
+
+        if (__atomic_compare_exchange_n(&list->share, &expected, share, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            list->block = NULL;
+        } else {
+            free(share);
+            share = expected;
+        }
+    }
+    __sync_fetch_and_add(&share->refs, 1);
+
+    new->share = share;
+    new->head_node = list->head_node;
+    new->last_node = list->last_node;
+    new->count = list->count;
+    new->flags = list->flags;
+    new->item_size = list->item_size;
+    new->alloc_node = list->alloc_node;
+    new->release_node = list->release_node;
+    new->release_item = NULL;
+
+    return new;
+}
+
+/** The items of the chain were taken over by the copies */
+static void chain_release(List *list, Node *node)
+{
+    Node *next;
+
+    while (node) {
+        next = node->next;
+        node_dispose(list, node);
+        node = next;
+    }
+    block_leave(list);
+}
+
+/** Leaves the share, returns true if the List was the last one using it */
+static bool share_leave(List *list)
+{
+    ListShare *share = list->share;
+
+    list->share = NULL;
+    if (share->owner == list) {
+        __atomic_store_n(&share->owner, NULL, __ATOMIC_RELEASE);
+    }
+    if (0 == __sync_sub_and_fetch(&share->refs, 1)) {
+        /** Nobody else can release the items anymore */
+        if (NULL == list->release_item) {
+            list->release_item = share->release_item;
+        }
+        list->block = share->block;
+        free(share);
+        return true;
+    }
+
+    return false;
+}
+
+void list_unshare(List *list)
+{
+    list_unshare_by(list, node_copy, NULL);
+}
+
+void list_unshare_by(List *list, NodeCopy copy, void *context)
+{
+    ListShare *share = list->share;
+    Node *node, *shared = list->head_node;
+    Release taken;
+
+    if (1 == __sync_fetch_and_add(&share->refs, 0)) {
+        share_leave(list);
+        return;
+    }
+    /** The owner takes the items with its copy, or if it's gone, the first one copying them */
+    if (share->owner == list) {
+        share->release_item = NULL;
+    } else if (NULL == __atomic_load_n(&share->owner, __ATOMIC_ACQUIRE)) {
+        taken = __atomic_exchange_n(&share->release_item, NULL, __ATOMIC_ACQ_REL);
+        if (taken && NULL == list->release_item) {
+            list->release_item = taken;
+        }
+    }
+    list->head_node = list->last_node = NULL;
+    list->count = 0;
+
+    for (node = shared; node; node = node->next) {
+        node_link_back(list, copy(list, node, context));
+    }
+    /** The others left in the meantime, so nobody is using the original nodes anymore */
+    if (share_leave(list)) {
+        chain_release(list, shared);
+    }
+}
+
+/** Releases everything, but the header itself, the List is left empty */
+static void destroy(List *list)
 {
     Node *tmp, *head = list->head_node;
 
+    list->head_node = list->last_node = NULL;
+    list->count = 0;
+    if (list->removed) {
+        list_release_removed(list);
+    }
+    if (list->adaptive) {
+        list_adaptive_free(list);
+    }
+    if (list->share && !share_leave(list)) {
+        return;
+    }
+    prefetch_init(list, head, next)
+
     while (head != NULL) {
+        prefetch_step(next)
         tmp = head;
         head = head->next;
 
-        if (list->release_item) {
-            list->release_item(tmp->value);
-        }
-        list->release_node(tmp);
+        node_free(list, tmp);
+    }
+    block_leave(list);
+}
+
+static void header_pool_free(void *unused)
+{
+    List *header;
+
+    (void) unused;
+    while ((header = HEADER_POOL)) {
+        HEADER_POOL = *(List **) header;
+        free(header);
     }
-    free(list);
+    HEADER_POOL_COUNT = 0;
+}
+
+static void create_header_key(void)
+{
+    pthread_key_create(&HEADER_KEY, header_pool_free);
+}
+
+static void header_release(List *list)
+{
+    if (HEADER_POOL_COUNT >= HEADER_POOL_SIZE) {
+        free(list);
+        return;
+    }
+    if (!HEADER_POOL_REGISTERED) {
+        /** The destructor only runs for a non-NULL value, it frees the pool when the thread exits */
+        pthread_once(&HEADER_KEY_ONCE, create_header_key);
+        pthread_setspecific(HEADER_KEY, &HEADER_POOL);
+        HEADER_POOL_REGISTERED = true;
+    }
+    *(List **) list = HEADER_POOL;
+    HEADER_POOL = list;
+    HEADER_POOL_COUNT++;
+}
+
+static List *header_new(void)
+{
+    List *header = HEADER_POOL;
+
+    if (NULL == header) {
+        return malloc(sizeof(List));
+    }
+    HEADER_POOL = *(List **) header;
+    HEADER_POOL_COUNT--;
+
+    return header;
+}
+
+static void free_(List *list)
+{
+    destroy(list);
+    header_release(list);
+}
+
+void list_destroy(List *list)
+{
+    destroy(list);
+}
+
+void list_header_trim(void)
+{
+    header_pool_free(NULL);
 }
 
 void list_set_allocators(Alloc node_alloc, Release node_release, Release item_release)
@@ -380,25 +1298,79 @@ void list_set_allocators(Alloc node_alloc, Release node_release, Release item_re
     DEFAULT_ITEM_RELEASE = item_release ? item_release : NULL;
 }
 
+void list_default_allocators(Alloc *node_alloc, Release *node_release, Release *item_release)
+{
+    *node_alloc = DEFAULT_NODE_ALLOC;
+    *node_release = DEFAULT_NODE_RELEASE;
+    *item_release = DEFAULT_ITEM_RELEASE;
+}
+
 size_t list_node_size(void)
 {
     return sizeof(Node);
 }
 
+void *list_node_value(Node *node)
+{
+    return node->value;
+}
+
 List *list_new(void)
 {
-    List *list = malloc(sizeof(List));
+    List *list = list_init(header_new());
+    list->free = free_;
+
+    return list;
+}
+
+/** Its free method only destroys it, so the List can be passed anywhere, that frees it */
+List *list_init(List *list)
+{
     list->count = 0;
+    list->flags = 0;
+    list->item_size = 0;
     list->clone = clone;
+    list->clone_cow = clone_cow;
     list->prepend = prepend;
     list->shift = shift;
     list->append = append;
+    list->prepend_copy = prepend_copy;
+    list->append_copy = append_copy;
+    list->shift_copy = shift_copy;
+    list->pop_copy = pop_copy;
+    list->sort = list_sort;
+    list->par_sort = list_par_sort;
+    list->sort_by_key = list_sort_by_key;
+    list->compact = compact;
+    list->shift_n = shift_n;
+    list->pop_n = pop_n;
+    list->take_all = take_all;
+    list->append_n = append_n;
+    list->prepend_n = prepend_n;
+    list->slice = list_slice;
+    list->take = list_take;
+    list->skip = list_skip;
+    list->split_at = split_at;
+    list->reverse = reverse;
+    list->rotate = rotate;
+    list->fragmentation = fragmentation;
+    list->prepend_h = prepend_h;
+    list->append_h = append_h;
+    list->move_to_front = move_to_front;
+    list->move_to_back = move_to_back;
+    list->move_before = move_before;
+    list->remove_h = remove_h;
     list->replace = replace;
     list->pop = pop;
     list->concat = concat;
     list->concat_f = concat_f;
     list->merge = merge;
     list->merge_f = merge_f;
+    list->distinct = distinct;
+    list->intersect = intersect;
+    list->difference = difference;
+    list->group_by = group_by;
+    list->partition_by = partition_by;
     list->get = get;
     list->set = set;
     list->has = has;
@@ -414,12 +1386,29 @@ List *list_new(void)
     list->filter = filter;
     list->head = head;
     list->last = end;
-    list->free = free_;
+    list->free = destroy;
     list->head_node = NULL;
     list->last_node = NULL;
     list->release_item = DEFAULT_ITEM_RELEASE;
     list->alloc_node = DEFAULT_NODE_ALLOC;
     list->release_node = DEFAULT_NODE_RELEASE;
+    list->reclaimer = NULL;
+    list->share = NULL;
+    list->block = NULL;
+    list->churn = 0;
+    list->removed = NULL;
+    list->removed_block = NULL;
+    list->adaptive = NULL;
+    list->hash = NULL;
+    list->equals = NULL;
+
+    return list;
+}
+
+List *list_new_sized(size_t item_size)
+{
+    List *list = list_new();
+    list->item_size = item_size;
 
     return list;
 }
@@ -7,23 +7,86 @@
 #include <stdbool.h>
 
 
+/** The callbacks will dereference the items, so traversals prefetch them too */
+#define LIST_PREFETCH_ITEMS 1
+
+/** The representations of an adaptive List, on top of the linked nodes */
+#define LIST_MODE_LINKED 0
+#define LIST_MODE_INDEXED 1
+#define LIST_MODE_HASHED 2
+
+/** Compacts the List after the removals, once as many nodes were released as it has, invalidates the handles */
+#define LIST_AUTO_COMPACT 2
+
+/**
+ * Turns the List around in O(1) for foreach, fold, rotate, the indexes of get, set and delete_at, and the methods
+ * working with the ends, like head, last, shift, pop, prepend, append, their _n, _h and _copy versions and
+ * move_to_front/back. The rest ignores it and keeps the stored order, like slice, take, skip, split_at, move_before,
+ * find, sort, group_by or the nodes of the views.
+ */
+#define LIST_REVERSED 4
+
+
 #define function(return_type, function_body) ({ return_type __fn__ function_body __fn__; })
 
 
 typedef struct Node Node;
 typedef struct List List;
+typedef struct Reclaimer Reclaimer;
+typedef struct ListShare ListShare;
+typedef struct ListBlock ListBlock;
+typedef struct ListView ListView;
+typedef struct ListAdaptive ListAdaptive;
 typedef bool (*Predicate)(void *);
 typedef void (*Foreach)(void *);
 typedef void *(*Map)(void *);
 typedef void *(*Fold)(void *value, void *current);
+typedef uint64_t (*Hash)(void *);
+typedef bool (*Equals)(void *, void *);
+typedef int (*Comparator)(void *, void *);
+typedef void *(*Key)(void *);
+typedef uint64_t (*SortKey)(void *);
+typedef size_t (*Bucket)(void *);
 
 typedef void *(*Alloc)(size_t);
 typedef void (*Release)(void *);
+typedef void (*Migrate)(List *, unsigned from, unsigned to);
+
+/**
+ * A range of a List, without copying its nodes. It's a plain value, nothing to free, but it's only
+ * valid until the List is modified.
+ */
+struct ListView {
+    Node *first;
+    Node *last;
+    size_t count;
+    ListView *(*foreach_l)(ListView *, Foreach);
+    ListView *(*foreach_r)(ListView *, Foreach);
+    void *(*fold_l)(ListView *, void *, Fold);
+    void *(*fold_r)(ListView *, void *, Fold);
+    void *(*find)(ListView *, Predicate);
+    bool (*exists)(ListView *, Predicate);
+};
+
+/**
+ * Decides when an adaptive List changes its representation. Every window operations the share of the
+ * index based and the membership lookups is compared to the thresholds, an index is dropped again
+ * when the share falls below the quarter of it.
+ */
+typedef struct {
+    size_t window;
+    size_t min_count;
+    double index_share;
+    double hash_share;
+    Migrate on_migrate;
+} ListTuning;
 
 struct List {
     Node *head_node;
     Node *last_node;
-    uint32_t count;
+    size_t count;
+    unsigned flags;
+    size_t item_size;
     List *(*prepend)(List *, void *);
     void *(*shift)(List *);
     List *(*append)(List *, void *);
@@ -39,28 +102,95 @@ struct List {
     List *(*concat_f)(List *, List *);
     List *(*merge)(List *, List *);
     List *(*merge_f)(List *, List *);
+    List *(*distinct)(List *);
+    List *(*intersect)(List *, List *);
+    List *(*difference)(List *, List *);
+    List *(*group_by)(List *, Key, Hash, Equals);
+    List **(*partition_by)(List *, Bucket, size_t k);
     List *(*clone)(List *);
+    List *(*clone_cow)(List *);
     void *(*fold_l)(List *, void *, Fold);
     void *(*fold_r)(List *, void *, Fold);
-    void *(*get)(List *, int);
-    List *(*set)(List *, int, void *);
+    void *(*get)(List *, ptrdiff_t);
+    List *(*set)(List *, ptrdiff_t, void *);
     bool (*has)(List *, void *);
     bool (*exists)(List *, Predicate);
     void *(*find)(List *, Predicate);
-    List *(*delete_at)(List *, int);
+    List *(*delete_at)(List *, ptrdiff_t);
     List *(*delete)(List *, void *);
     void (*free)(List *);
+    Node *(*prepend_h)(List *, void *);
+    Node *(*append_h)(List *, void *);
+    List *(*move_to_front)(List *, Node *);
+    List *(*move_to_back)(List *, Node *);
+    List *(*move_before)(List *, Node *node, Node *before);
+    void *(*remove_h)(List *, Node *);
+    List *(*prepend_copy)(List *, void *);
+    List *(*append_copy)(List *, void *);
+    bool (*shift_copy)(List *, void *out);
+    bool (*pop_copy)(List *, void *out);
+    List *(*sort)(List *, Comparator);
+    List *(*par_sort)(List *, Comparator, unsigned threads);
+    List *(*sort_by_key)(List *, SortKey);
+    List *(*compact)(List *);
+    size_t (*shift_n)(List *, void **out, size_t n);
+    size_t (*pop_n)(List *, void **out, size_t n);
+    List *(*take_all)(List *);
+    List *(*append_n)(List *, void **items, size_t n);
+    List *(*prepend_n)(List *, void **items, size_t n);
+    ListView (*slice)(List *, ptrdiff_t from, ptrdiff_t to);
+    ListView (*take)(List *, ptrdiff_t n);
+    ListView (*skip)(List *, ptrdiff_t n);
+    List *(*split_at)(List *, ptrdiff_t index);
+    List *(*reverse)(List *);
+    List *(*rotate)(List *, ptrdiff_t k);
+    double (*fragmentation)(List *);
     Release release_item;
     Alloc alloc_node;
     Release release_node;
+    Reclaimer *reclaimer;
+    ListShare *share;
+    ListBlock *block;
+    size_t churn;
+    Node *removed;
+    ListBlock *removed_block;
+    ListAdaptive *adaptive;
+    Hash hash;
+    Equals equals;
 };
 
 
 List *list_new(void);
 
+/**
+ * Initializes a List in the given storage, for example in a struct or on the stack. Its
+ * free method is the same as list_destroy().
+ */
+List *list_init(List *list);
+
+/** Releases the nodes and the items of the List, but not the storage of the List itself */
+void list_destroy(List *list);
+
+/** Frees the List headers kept by the calling thread for reuse */
+void list_header_trim(void);
+
+/** The _copy methods of the List will copy item_size bytes into the node */
+List *list_new_sized(size_t item_size);
+
 void list_set_allocators(Alloc node_alloc, Release node_release, Release item_release);
 
 size_t list_node_size(void);
 
+void *list_node_value(Node *node);
+
+/**
+ * Tracks the operations of the List, and keeps a Node array for get() and set(), and a hash index for has()
+ * when they are frequent enough. The tuning is copied, NULL uses the defaults.
+ */
+List *list_adapt(List *list, ListTuning *tuning);
+
+/** The LIST_MODE_ flags of an adaptive List */
+unsigned list_mode(List *list);
+
 
 #endif
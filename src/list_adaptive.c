@@ -0,0 +1,382 @@
+#include <stdlib.h>
+#include "list_internal.h"
+#include "hash_set.h"
+
+
+#define MIN_INDEX_CAPACITY 16
+
+
+/**
+ * The linked nodes stay the storage, so every method and node handle keeps working, the indexes are
+ * only kept up to date by the wrapped methods, any other modification makes them rebuilt when needed
+ */
+typedef struct {
+    ListAdaptive adaptive;
+    unsigned mode;
+    ListTuning tuning;
+    uint64_t window_version;
+    size_t reads;
+    size_t lookups;
+    Node **nodes;
+    size_t start;
+    size_t capacity;
+    uint64_t indexed_version;
+    HashSet *counts;
+    uint64_t hashed_version;
+    void *(*get)(List *, ptrdiff_t);
+    List *(*set)(List *, ptrdiff_t, void *);
+    bool (*has)(List *, void *);
+    List *(*prepend)(List *, void *);
+    List *(*append)(List *, void *);
+    void *(*shift)(List *);
+    void *(*pop)(List *);
+} Adaptive;
+
+
+static ListTuning DEFAULT_TUNING = {1024, 64, 0.25, 0.25, NULL};
+
+
+static Adaptive *adaptive_of(List *list)
+{
+    return (Adaptive *) list->adaptive;
+}
+
+static bool is_indexed(Adaptive *adaptive)
+{
+    return adaptive->nodes && adaptive->indexed_version == adaptive->adaptive.version;
+}
+
+static bool is_hashed(Adaptive *adaptive)
+{
+    return adaptive->counts && adaptive->hashed_version == adaptive->adaptive.version;
+}
+
+/** The nodes are in the middle of the array, so both ends can grow */
+static void index_build(List *list, Adaptive *adaptive)
+{
+    Node *node;
+    size_t i = 0;
+
+    free(adaptive->nodes);
+    adaptive->capacity = list->count < MIN_INDEX_CAPACITY / 2 ? MIN_INDEX_CAPACITY : list->count * 2;
+    adaptive->nodes = malloc(adaptive->capacity * sizeof(Node *));
+    adaptive->start = (adaptive->capacity - list->count) / 2;
+
+    for (node = list->head_node; node; node = node->next) {
+        adaptive->nodes[adaptive->start + i++] = node;
+    }
+    adaptive->indexed_version = adaptive->adaptive.version;
+}
+
+static void count_item(HashSet *counts, void *item, int change)
+{
+    void **count = hash_set_value(counts, item);
+
+    *count = (void *) ((uintptr_t) *count + change);
+}
+
+static void hash_build(List *list, Adaptive *adaptive)
+{
+    Node *node;
+
+    if (adaptive->counts) {
+        hash_set_free(adaptive->counts);
+    }
+    adaptive->counts = hash_set_new(list->count, NULL, NULL);
+
+    for (node = list->head_node; node; node = node->next) {
+        count_item(adaptive->counts, node->value, 1);
+    }
+    adaptive->hashed_version = adaptive->adaptive.version;
+}
+
+static void index_release(Adaptive *adaptive)
+{
+    free(adaptive->nodes);
+    adaptive->nodes = NULL;
+}
+
+static void hash_release(Adaptive *adaptive)
+{
+    if (adaptive->counts) {
+        hash_set_free(adaptive->counts);
+        adaptive->counts = NULL;
+    }
+}
+
+/** The indexes are built lazily, at the first operation needing them */
+static void migrate(List *list, Adaptive *adaptive, unsigned mode)
+{
+    unsigned from = adaptive->mode;
+
+    if (!(mode & LIST_MODE_INDEXED)) {
+        index_release(adaptive);
+    }
+    if (!(mode & LIST_MODE_HASHED)) {
+        hash_release(adaptive);
+    }
+    adaptive->mode = mode;
+
+    if (adaptive->tuning.on_migrate) {
+        adaptive->tuning.on_migrate(list, from, mode);
+    }
+}
+
+/** The modifications are counted by the versions, they're bumped by every one of them */
+static void observe(List *list, Adaptive *adaptive)
+{
+    ListTuning *tuning = &adaptive->tuning;
+    size_t total = adaptive->reads + adaptive->lookups + (adaptive->adaptive.version - adaptive->window_version);
+    unsigned mode = adaptive->mode;
+
+    if (total < tuning->window) {
+        return;
+    }
+    if (list->count >= tuning->min_count && adaptive->reads >= total * tuning->index_share) {
+        mode |= LIST_MODE_INDEXED;
+    } else if (adaptive->reads < total * tuning->index_share / 4) {
+        mode &= ~LIST_MODE_INDEXED;
+    }
+    if (list->count >= tuning->min_count && adaptive->lookups >= total * tuning->hash_share) {
+        mode |= LIST_MODE_HASHED;
+    } else if (adaptive->lookups < total * tuning->hash_share / 4) {
+        mode &= ~LIST_MODE_HASHED;
+    }
+    adaptive->reads = adaptive->lookups = 0;
+    adaptive->window_version = adaptive->adaptive.version;
+
+    if (mode != adaptive->mode) {
+        migrate(list, adaptive, mode);
+    }
+}
+
+/** Returns NULL if it's out of bounds */
+static Node *indexed_node(List *list, Adaptive *adaptive, ptrdiff_t index)
+{
+    size_t position;
+
+    if (!is_indexed(adaptive)) {
+        index_build(list, adaptive);
+    }
+    if (index < 0) {
+        if (distance_from_end(index) > list->count) {
+            return NULL;
+        }
+        position = list->count - distance_from_end(index);
+    } else {
+        position = (size_t) index;
+    }
+
+    return position < list->count ? adaptive->nodes[adaptive->start + position] : NULL;
+}
+
+static void *get(List *list, ptrdiff_t index)
+{
+    Adaptive *adaptive = adaptive_of(list);
+    Node *node;
+
+    adaptive->reads++;
+    observe(list, adaptive);
+
+    if (adaptive->mode & LIST_MODE_INDEXED) {
+        node = indexed_node(list, adaptive, stored_index(list, index));
+        return node ? node->value : NULL;
+    }
+
+    return adaptive->get(list, index);
+}
+
+/** Only the item changes, so the node index stays valid, and the hash index is updated */
+static List *set(List *list, ptrdiff_t index, void *value)
+{
+    Adaptive *adaptive = adaptive_of(list);
+    bool hashed;
+    Node *node;
+
+    adaptive->reads++;
+    observe(list, adaptive);
+
+    if (!(adaptive->mode & LIST_MODE_INDEXED) || list->share) {
+        adaptive->set(list, index, value);
+        return list;
+    }
+    node = indexed_node(list, adaptive, stored_index(list, index));
+    if (node) {
+        hashed = is_hashed(adaptive);
+        will_mutate(list);
+        if (hashed) {
+            count_item(adaptive->counts, node->value, -1);
+            count_item(adaptive->counts, value, 1);
+            adaptive->hashed_version = adaptive->adaptive.version;
+        }
+        node->value = value;
+        adaptive->indexed_version = adaptive->adaptive.version;
+    }
+
+    return list;
+}
+
+static bool has(List *list, void *item)
+{
+    Adaptive *adaptive = adaptive_of(list);
+    void **count;
+
+    adaptive->lookups++;
+    observe(list, adaptive);
+
+    if (adaptive->mode & LIST_MODE_HASHED) {
+        if (!is_hashed(adaptive)) {
+            hash_build(list, adaptive);
+        }
+        count = hash_set_find(adaptive->counts, item);
+        return count && *count;
+    }
+
+    return adaptive->has(list, item);
+}
+
+/** The indexes are updated, if they were valid before the only modification made by the method, front is the stored head */
+static void added(List *list, Adaptive *adaptive, uint64_t version, bool front)
+{
+    Node *node = front ? list->head_node : list->last_node;
+
+    if (adaptive->adaptive.version != version + 1) {
+        return;
+    }
+    if (adaptive->nodes && adaptive->indexed_version == version) {
+        if (front && adaptive->start > 0) {
+            adaptive->nodes[--adaptive->start] = node;
+            adaptive->indexed_version++;
+        } else if (!front && adaptive->start + list->count <= adaptive->capacity) {
+            adaptive->nodes[adaptive->start + list->count - 1] = node;
+            adaptive->indexed_version++;
+        }
+    }
+    if (adaptive->counts && adaptive->hashed_version == version) {
+        count_item(adaptive->counts, node->value, 1);
+        adaptive->hashed_version++;
+    }
+}
+
+static void removed(List *list, Adaptive *adaptive, uint64_t version, void *item, bool front)
+{
+    if (adaptive->adaptive.version != version + 1) {
+        return;
+    }
+    if (adaptive->nodes && adaptive->indexed_version == version) {
+        adaptive->start += front;
+        adaptive->indexed_version++;
+    }
+    /** The items counted to 0 stay in the hash, it's rebuilt when they'd outnumber the List */
+    if (adaptive->counts && adaptive->hashed_version == version && hash_set_count(adaptive->counts) <= 2 * list->count + MIN_INDEX_CAPACITY) {
+        count_item(adaptive->counts, item, -1);
+        adaptive->hashed_version++;
+    }
+}
+
+static List *prepend(List *list, void *value)
+{
+    Adaptive *adaptive = adaptive_of(list);
+    uint64_t version = adaptive->adaptive.version;
+
+    adaptive->prepend(list, value);
+    added(list, adaptive, version, stored_front(list, true));
+    observe(list, adaptive);
+
+    return list;
+}
+
+static List *append(List *list, void *value)
+{
+    Adaptive *adaptive = adaptive_of(list);
+    uint64_t version = adaptive->adaptive.version;
+
+    adaptive->append(list, value);
+    added(list, adaptive, version, stored_front(list, false));
+    observe(list, adaptive);
+
+    return list;
+}
+
+static void *shift(List *list)
+{
+    Adaptive *adaptive = adaptive_of(list);
+    uint64_t version = adaptive->adaptive.version;
+    size_t count = list->count;
+    void *item = adaptive->shift(list);
+
+    if (count != list->count) {
+        removed(list, adaptive, version, item, stored_front(list, true));
+    }
+    observe(list, adaptive);
+
+    return item;
+}
+
+static void *pop(List *list)
+{
+    Adaptive *adaptive = adaptive_of(list);
+    uint64_t version = adaptive->adaptive.version;
+    size_t count = list->count;
+    void *item = adaptive->pop(list);
+
+    if (count != list->count) {
+        removed(list, adaptive, version, item, stored_front(list, false));
+    }
+    observe(list, adaptive);
+
+    return item;
+}
+
+List *list_adapt(List *list, ListTuning *tuning)
+{
+    Adaptive *adaptive;
+
+    if (list->adaptive) {
+        return list;
+    }
+    adaptive = calloc(1, sizeof(Adaptive));
+    adaptive->tuning = tuning ? *tuning : DEFAULT_TUNING;
+    adaptive->mode = LIST_MODE_LINKED;
+    adaptive->get = list->get;
+    adaptive->set = list->set;
+    adaptive->has = list->has;
+    adaptive->prepend = list->prepend;
+    adaptive->append = list->append;
+    adaptive->shift = list->shift;
+    adaptive->pop = list->pop;
+    list->adaptive = &adaptive->adaptive;
+
+    list->get = get;
+    list->set = set;
+    list->has = has;
+    list->prepend = prepend;
+    list->append = append;
+    list->shift = shift;
+    list->pop = pop;
+
+    return list;
+}
+
+unsigned list_mode(List *list)
+{
+    return list->adaptive ? adaptive_of(list)->mode : LIST_MODE_LINKED;
+}
+
+/** Puts the methods back, so the List keeps working after list_destroy() */
+void list_adaptive_free(List *list)
+{
+    Adaptive *adaptive = adaptive_of(list);
+
+    list->get = adaptive->get;
+    list->set = adaptive->set;
+    list->has = adaptive->has;
+    list->prepend = adaptive->prepend;
+    list->append = adaptive->append;
+    list->shift = adaptive->shift;
+    list->pop = adaptive->pop;
+    index_release(adaptive);
+    hash_release(adaptive);
+    free(adaptive);
+    list->adaptive = NULL;
+}
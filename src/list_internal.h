@@ -0,0 +1,209 @@
+#ifndef ROGUE_CRAFT_LIST_INTERNAL_H
+#define ROGUE_CRAFT_LIST_INTERNAL_H
+
+/** Shared between the collection's own translation units only, it's not part of the public API */
+
+#include "list.h"
+
+
+/** How many nodes ahead the traversals prefetch, 0 disables it */
+#ifndef LIST_PREFETCH_DISTANCE
+#define LIST_PREFETCH_DISTANCE 4
+#endif
+
+
+struct Node {
+    Node *next;
+    Node *prev;
+    void *value;
+};
+
+/**
+ * The node chain shared by the Lists created with clone_cow(), the items belong to the
+ * owner List, or whoever releases the chain after the owner is freed
+ */
+struct ListShare {
+    size_t refs;
+    List *owner;
+    Release release_item;
+    ListBlock *block;
+};
+
+
+static inline uint64_t hash_pointer(void *ptr)
+{
+    uint64_t hash = (uintptr_t) ptr;
+
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+
+    return hash;
+}
+
+/** The ones set by list_set_allocators(), for the other collections built on the same hooks */
+void list_default_allocators(Alloc *node_alloc, Release *node_release, Release *item_release);
+
+/** Makes the List's own copy of a shared node, for the collections with larger nodes */
+typedef Node *(*NodeCopy)(List *list, Node *node, void *context);
+
+/** Gives the List its own copy of the shared nodes */
+void list_unshare(List *list);
+
+void list_unshare_by(List *list, NodeCopy copy, void *context);
+
+/** Releases a detached node without its item, through the reclaimer, or back to the block it's in */
+void node_dispose(List *list, Node *node);
+
+/** Releases the nodes of the inline items removed by the last change, their pointers were valid until now */
+void list_release_removed(List *list);
+
+/** The first member of the adaptive state, the indexes are valid only for the version they were built at */
+struct ListAdaptive {
+    uint64_t version;
+};
+
+/** Has to be called before every modification of the node chain or the items in it */
+static inline void will_mutate(List *list)
+{
+    if (list->removed) {
+        list_release_removed(list);
+    }
+    if (list->share) {
+        list_unshare(list);
+    }
+    if (list->adaptive) {
+        list->adaptive->version++;
+    }
+}
+
+void list_adaptive_free(List *list);
+
+/** Stable merge sorts, they only relink the nodes */
+List *list_sort(List *list, Comparator comparator);
+
+List *list_par_sort(List *list, Comparator comparator, unsigned threads);
+
+/** Stable radix sort by integer keys, also only relinking the nodes */
+List *list_sort_by_key(List *list, SortKey key);
+
+/** Walks from the nearer end, the position has to be in bounds */
+static inline Node *node_near(List *list, size_t position)
+{
+    Node *node;
+    size_t i;
+
+    if (position < list->count / 2) {
+        for (node = list->head_node, i = 0; i < position; i++) {
+            node = node->next;
+        }
+    } else {
+        for (node = list->last_node, i = list->count - 1; i > position; i--) {
+            node = node->prev;
+        }
+    }
+
+    return node;
+}
+
+/** The magnitude of a negative index, without overflowing for PTRDIFF_MIN */
+static inline size_t distance_from_end(ptrdiff_t index)
+{
+    return (size_t) -(index + 1) + 1;
+}
+
+/** Negative indexes count from the end, the result is clamped to 0..count */
+static inline size_t position_of(List *list, ptrdiff_t index)
+{
+    if (index < 0) {
+        return distance_from_end(index) > list->count ? 0 : list->count - distance_from_end(index);
+    }
+
+    return (size_t) index > list->count ? list->count : (size_t) index;
+}
+
+/** The index in the stored order, ~index counts from the other end, same as -index - 1 */
+static inline ptrdiff_t stored_index(List *list, ptrdiff_t index)
+{
+    return list->flags & LIST_REVERSED ? ~index : index;
+}
+
+/** Whether an end of the List is the stored head, LIST_REVERSED turns them around */
+static inline bool stored_front(List *list, bool front)
+{
+    return list->flags & LIST_REVERSED ? !front : front;
+}
+
+static inline Node *end_node(List *list, bool front)
+{
+    return stored_front(list, front) ? list->head_node : list->last_node;
+}
+
+/** The views of a range of the List, the end is exclusive */
+ListView list_slice(List *list, ptrdiff_t from, ptrdiff_t to);
+
+ListView list_take(List *list, ptrdiff_t n);
+
+ListView list_skip(List *list, ptrdiff_t n);
+
+/** Detaches the node from the chain without releasing anything */
+static inline void node_unlink(List *list, Node *node)
+{
+    if (node->prev) {
+        node->prev->next = node->next;
+    } else {
+        list->head_node = node->next;
+    }
+    if (node->next) {
+        node->next->prev = node->prev;
+    } else {
+        list->last_node = node->prev;
+    }
+    node->prev = node->next = NULL;
+    list->count--;
+}
+
+static inline void node_link_front(List *list, Node *node)
+{
+    node->prev = NULL;
+    node->next = list->head_node;
+
+    if (list->head_node) {
+        list->head_node->prev = node;
+    } else {
+        list->last_node = node;
+    }
+    list->head_node = node;
+    list->count++;
+}
+
+static inline void node_link_back(List *list, Node *node)
+{
+    node->next = NULL;
+    node->prev = list->last_node;
+
+    if (list->last_node) {
+        list->last_node->next = node;
+    } else {
+        list->head_node = node;
+    }
+    list->last_node = node;
+    list->count++;
+}
+
+static inline void node_link_before(List *list, Node *node, Node *before)
+{
+    node->next = before;
+    node->prev = before->prev;
+
+    if (before->prev) {
+        before->prev->next = node;
+    } else {
+        list->head_node = node;
+    }
+    before->prev = node;
+    list->count++;
+}
+
+
+#endif
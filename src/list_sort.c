@@ -0,0 +1,271 @@
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "list_internal.h"
+
+
+/** Below this, starting the threads costs more, than what they could save */
+#define PARALLEL_THRESHOLD 16384
+#define MAX_BINS 64
+#define RADIX_BITS 8
+#define RADIX (1 << RADIX_BITS)
+#define KEY_DIGITS (64 / RADIX_BITS)
+
+
+typedef struct {
+    Node *first;
+    Node *second;
+    Comparator comparator;
+} SortJob;
+
+typedef struct {
+    uint64_t key;
+    Node *node;
+} KeyedNode;
+
+
+/** Merges two singly linked chains, on equal items the first one's will come first */
+static Node *chain_merge(Node *first, Node *second, Comparator comparator)
+{
+    Node head, *tail = &head;
+
+    while (first && second) {
+        if (comparator(second->value, first->value) < 0) {
+            tail->next = second;
+            second = second->next;
+        } else {
+            tail->next = first;
+            first = first->next;
+        }
+        tail = tail->next;
+    }
+    tail->next = first ? first : second;
+
+    return head.next;
+}
+
+/** Bottom-up merge sort, the nth bin holds a sorted run of 2^n nodes, so no recursion is needed */
+static Node *chain_sort(Node *chain, Comparator comparator)
+{
+    Node *bins[MAX_BINS], *carry;
+    int i, fill = 0;
+
+    while (chain) {
+        carry = chain;
+        chain = chain->next;
+        carry->next = NULL;
+
+        for (i = 0; i < fill && bins[i]; i++) {
+            carry = chain_merge(bins[i], carry, comparator);
+            bins[i] = NULL;
+        }
+        bins[i] = carry;
+        if (i == fill) {
+            fill++;
+        }
+    }
+    for (carry = NULL, i = 0; i < fill; i++) {
+        if (bins[i]) {
+            carry = chain_merge(bins[i], carry, comparator);
+        }
+    }
+
+    return carry;
+}
+
+/** Restores the prev links, and the ends of the List after the chain was sorted by its next links */
+static void relink(List *list, Node *chain)
+{
+    Node *prev = NULL;
+
+    list->head_node = chain;
+    while (chain) {
+        chain->prev = prev;
+        prev = chain;
+        chain = chain->next;
+    }
+    list->last_node = prev;
+}
+
+List *list_sort(List *list, Comparator comparator)
+{
+    will_mutate(list);
+    relink(list, chain_sort(list->head_node, comparator));
+
+    return list;
+}
+
+static void *sort_job(void *arg)
+{
+    SortJob *job = arg;
+
+    job->first = chain_sort(job->first, job->comparator);
+
+    return NULL;
+}
+
+static void *merge_job(void *arg)
+{
+    SortJob *job = arg;
+
+    job->first = chain_merge(job->first, job->second, job->comparator);
+
+    return NULL;
+}
+
+/** Runs the jobs concurrently, the first one, and those without a thread, on the calling thread */
+static void run_jobs(SortJob *jobs, size_t count, void *(*run)(void *))
+{
+    pthread_t *threads = malloc(count * sizeof(pthread_t));
+    bool *started = malloc(count * sizeof(bool));
+    size_t i;
+
+    for (i = 1; i < count; i++) {
+        started[i] = 0 == pthread_create(&threads[i], NULL, run, &jobs[i]);
+    }
+    run(&jobs[0]);
+    for (i = 1; i < count; i++) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        } else {
+            run(&jobs[i]);
+        }
+    }
+    free(started);
+    free(threads);
+}
+
+/** Every run gets at least PARALLEL_THRESHOLD nodes, and there are no more runs, than CPUs */
+static size_t runs_of(size_t count, unsigned threads)
+{
+    size_t runs = count / PARALLEL_THRESHOLD;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (runs > threads) {
+        runs = threads;
+    }
+    if (cpus > 0 && runs > (size_t) cpus) {
+        runs = (size_t) cpus;
+    }
+
+    return runs;
+}
+
+/** Cuts the chain into runs of nearly equal length */
+static void split(List *list, SortJob *jobs, size_t count, Comparator comparator)
+{
+    size_t i, length, remaining = list->count;
+    Node *node = list->head_node, *last;
+
+    for (i = 0; i < count; i++) {
+        length = remaining / (count - i);
+        remaining -= length;
+        jobs[i].first = node;
+        jobs[i].second = NULL;
+        jobs[i].comparator = comparator;
+
+        for (last = node; --length; last = last->next);
+        node = last->next;
+        last->next = NULL;
+    }
+}
+
+/**
+ * The runs are sorted concurrently, then merged pairwise, every round of merges runs concurrently
+ * too. Only the links are changed, the items are never copied.
+ */
+List *list_par_sort(List *list, Comparator comparator, unsigned threads)
+{
+    SortJob *jobs;
+    size_t i, runs = runs_of(list->count, threads);
+
+    will_mutate(list);
+    if (runs <= 1) {
+        return list_sort(list, comparator);
+    }
+    jobs = malloc(runs * sizeof(SortJob));
+    split(list, jobs, runs, comparator);
+    run_jobs(jobs, runs, sort_job);
+
+    while (runs > 1) {
+        for (i = 0; i < runs / 2; i++) {
+            jobs[i].first = jobs[2 * i].first;
+            jobs[i].second = jobs[2 * i + 1].first;
+        }
+        if (runs % 2) {
+            jobs[i].first = jobs[runs - 1].first;
+            jobs[i].second = NULL;
+        }
+        run_jobs(jobs, runs / 2, merge_job);
+        runs = (runs + 1) / 2;
+    }
+    relink(list, jobs[0].first);
+    free(jobs);
+
+    return list;
+}
+
+/** Moves the pairs into the buckets of the digit, keeping their order within the buckets */
+static void scatter(KeyedNode *from, KeyedNode *to, size_t count, size_t *histogram, int shift)
+{
+    size_t i, offset = 0, size;
+
+    for (i = 0; i < RADIX; i++) {
+        size = histogram[i];
+        histogram[i] = offset;
+        offset += size;
+    }
+    for (i = 0; i < count; i++) {
+        to[histogram[(from[i].key >> shift) & (RADIX - 1)]++] = from[i];
+    }
+}
+
+/**
+ * LSD radix sort on (key, node) pairs, the keys are extracted once. The histograms of every digit
+ * are counted in the same pass, and the digits that are the same for every key are skipped.
+ */
+List *list_sort_by_key(List *list, SortKey key)
+{
+    size_t (*histograms)[RADIX], count = list->count, i;
+    KeyedNode *pairs, *scratch, *swap;
+    uint64_t differs = 0;
+    Node *node;
+    int digit;
+
+    will_mutate(list);
+    if (count < 2) {
+        return list;
+    }
+    pairs = malloc(count * sizeof(KeyedNode));
+    scratch = malloc(count * sizeof(KeyedNode));
+    histograms = calloc(KEY_DIGITS, sizeof(*histograms));
+
+    for (node = list->head_node, i = 0; node; node = node->next, i++) {
+        pairs[i].key = key(node->value);
+        pairs[i].node = node;
+        differs |= pairs[i].key ^ pairs[0].key;
+
+        for (digit = 0; digit < KEY_DIGITS; digit++) {
+            histograms[digit][(pairs[i].key >> (digit * RADIX_BITS)) & (RADIX - 1)]++;
+        }
+    }
+    for (digit = 0; digit < KEY_DIGITS; digit++) {
+        if ((differs >> (digit * RADIX_BITS)) & (RADIX - 1)) {
+            scatter(pairs, scratch, count, histograms[digit], digit * RADIX_BITS);
+            swap = pairs;
+            pairs = scratch;
+            scratch = swap;
+        }
+    }
+    for (i = 0; i < count - 1; i++) {
+        pairs[i].node->next = pairs[i + 1].node;
+    }
+    pairs[count - 1].node->next = NULL;
+    relink(list, pairs[0].node);
+
+    free(pairs);
+    free(scratch);
+    free(histograms);
+
+    return list;
+}
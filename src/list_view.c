@@ -0,0 +1,96 @@
+#include "list_internal.h"
+
+
+#define view_walk(view, from, direction, ...)                           \
+        Node *node = view->from;                                        \
+        size_t i;                                                       \
+        for (i = 0; i < view->count; i++) {                             \
+            __VA_ARGS__;                                                \
+            node = node->direction;                                     \
+        }                                                               \
+
+
+static ListView *foreach_l(ListView *view, Foreach foreach)
+{
+    view_walk(view, first, next, foreach(node->value));
+
+    return view;
+}
+
+static ListView *foreach_r(ListView *view, Foreach foreach)
+{
+    view_walk(view, last, prev, foreach(node->value));
+
+    return view;
+}
+
+static void *fold_l(ListView *view, void *value, Fold fold)
+{
+    view_walk(view, first, next, value = fold(value, node->value));
+
+    return value;
+}
+
+static void *fold_r(ListView *view, void *value, Fold fold)
+{
+    view_walk(view, last, prev, value = fold(value, node->value));
+
+    return value;
+}
+
+static void *find(ListView *view, Predicate predicate)
+{
+    view_walk(view, first, next,
+              if (predicate(node->value)) return node->value;
+    )
+
+    return NULL;
+}
+
+static bool exists(ListView *view, Predicate predicate)
+{
+    view_walk(view, first, next,
+              if (predicate(node->value)) return true;
+    )
+
+    return false;
+}
+
+/** The last node is counted from the first one, or searched from the nearer end, whichever is shorter */
+ListView list_slice(List *list, ptrdiff_t from, ptrdiff_t to)
+{
+    ListView view;
+    size_t start = position_of(list, from), end = position_of(list, to), i;
+
+    view.first = view.last = NULL;
+    view.count = start < end ? end - start : 0;
+
+    if (view.count) {
+        view.first = node_near(list, start);
+        if (list->count - end < view.count) {
+            view.last = node_near(list, end - 1);
+        } else {
+            for (view.last = view.first, i = 1; i < view.count; i++) {
+                view.last = view.last->next;
+            }
+        }
+    }
+    view.foreach_l = foreach_l;
+    view.foreach_r = foreach_r;
+    view.fold_l = fold_l;
+    view.fold_r = fold_r;
+    view.find = find;
+    view.exists = exists;
+
+    return view;
+}
+
+ListView list_take(List *list, ptrdiff_t n)
+{
+    return list_slice(list, 0, n < 0 ? 0 : n);
+}
+
+ListView list_skip(List *list, ptrdiff_t n)
+{
+    return list_slice(list, n < 0 ? 0 : n, PTRDIFF_MAX);
+}
@@ -0,0 +1,246 @@
+#include <stdlib.h>
+#include "lru.h"
+#include "list_internal.h"
+
+
+/** The Node has to be the first member, so the entry can be used as a node of the order List */
+struct LruEntry {
+    Node node;
+    void *key;
+    uint64_t hash;
+};
+
+
+static uint64_t hash_of(LruCache *cache, void *key)
+{
+    return cache->hash ? cache->hash(key) : hash_pointer(key);
+}
+
+static bool key_equals(LruCache *cache, void *a, void *b)
+{
+    return cache->equals ? cache->equals(a, b) : a == b;
+}
+
+static size_t slot_of(LruCache *cache, void *key, uint64_t hash)
+{
+    size_t i = hash & cache->mask;
+    LruEntry *entry;
+
+    while ((entry = cache->slots[i])) {
+        if (entry->hash == hash && key_equals(cache, entry->key, key)) {
+            break;
+        }
+        i = (i + 1) & cache->mask;
+    }
+
+    return i;
+}
+
+static LruEntry *entry_find(LruCache *cache, void *key)
+{
+    return cache->slots[slot_of(cache, key, hash_of(cache, key))];
+}
+
+/** Backward shift deletion, keeps the probe sequences intact without tombstones */
+static void slot_remove(LruCache *cache, size_t i)
+{
+    size_t j = i, home;
+
+    cache->slots[i] = NULL;
+
+    while (cache->slots[j = (j + 1) & cache->mask]) {
+        home = cache->slots[j]->hash & cache->mask;
+
+        if (i <= j ? (home <= i || home > j) : (home <= i && home > j)) {
+            cache->slots[i] = cache->slots[j];
+            cache->slots[j] = NULL;
+            i = j;
+        }
+    }
+}
+
+static Node *entry_copy(List *order, Node *node, void *context)
+{
+    LruCache *cache = context;
+    LruEntry *old = (LruEntry *) node, *entry = order->alloc_node(sizeof(LruEntry));
+
+    entry->key = old->key;
+    entry->hash = old->hash;
+    entry->node.value = old->node.value;
+    cache->slots[slot_of(cache, old->key, old->hash)] = entry;
+
+    return &entry->node;
+}
+
+/**
+ * The entries are the nodes of the order List, so when a snapshot of it shares them, the cache copies
+ * them to new entries, and leaves the old chain to the snapshots. Has to be called before the entries are looked up.
+ */
+static void order_own(LruCache *cache)
+{
+    if (cache->order->share) {
+        list_unshare_by(cache->order, entry_copy, cache);
+    }
+}
+
+static void entry_free(LruCache *cache, LruEntry *entry)
+{
+    slot_remove(cache, slot_of(cache, entry->key, entry->hash));
+    will_mutate(cache->order);
+    node_unlink(cache->order, &entry->node);
+
+    if (cache->release_key) {
+        cache->release_key(entry->key);
+    }
+    if (cache->release_item) {
+        cache->release_item(entry->node.value);
+    }
+    node_dispose(cache->order, &entry->node);
+}
+
+static void touch_entry(LruCache *cache, LruEntry *entry)
+{
+    cache->order->move_to_front(cache->order, &entry->node);
+}
+
+static void *peek(LruCache *cache, void *key)
+{
+    LruEntry *entry = entry_find(cache, key);
+
+    return entry ? entry->node.value : NULL;
+}
+
+static void *get(LruCache *cache, void *key)
+{
+    LruEntry *entry;
+
+    order_own(cache);
+    entry = entry_find(cache, key);
+
+    if (entry) {
+        touch_entry(cache, entry);
+        return entry->node.value;
+    }
+    return NULL;
+}
+
+static bool has(LruCache *cache, void *key)
+{
+    return NULL != entry_find(cache, key);
+}
+
+static bool touch(LruCache *cache, void *key)
+{
+    LruEntry *entry;
+
+    order_own(cache);
+    entry = entry_find(cache, key);
+
+    if (entry) {
+        touch_entry(cache, entry);
+    }
+    return NULL != entry;
+}
+
+static LruCache *evict(LruCache *cache)
+{
+    order_own(cache);
+    if (cache->order->last_node) {
+        entry_free(cache, (LruEntry *) cache->order->last_node);
+    }
+
+    return cache;
+}
+
+static LruCache *put(LruCache *cache, void *key, void *value)
+{
+    uint64_t hash = hash_of(cache, key);
+    size_t i;
+    LruEntry *entry;
+
+    order_own(cache);
+    i = slot_of(cache, key, hash);
+    entry = cache->slots[i];
+
+    if (entry) {
+        /** The stored key is kept, an equal one passed in is not needed anymore */
+        if (cache->release_key && entry->key != key) {
+            cache->release_key(key);
+        }
+        if (cache->release_item && entry->node.value != value) {
+            cache->release_item(entry->node.value);
+        }
+        entry->node.value = value;
+        touch_entry(cache, entry);
+
+        return cache;
+    }
+    if (cache->order->count >= cache->capacity) {
+        cache->evict(cache);
+        i = slot_of(cache, key, hash);
+    }
+    entry = cache->order->alloc_node(sizeof(LruEntry));
+    entry->key = key;
+    entry->hash = hash;
+    entry->node.value = value;
+    cache->slots[i] = entry;
+    will_mutate(cache->order);
+    node_link_front(cache->order, &entry->node);
+
+    return cache;
+}
+
+static LruCache *delete(LruCache *cache, void *key)
+{
+    LruEntry *entry;
+
+    order_own(cache);
+    entry = entry_find(cache, key);
+
+    if (entry) {
+        entry_free(cache, entry);
+    }
+
+    return cache;
+}
+
+static void free_(LruCache *cache)
+{
+    order_own(cache);
+    while (cache->order->last_node) {
+        entry_free(cache, (LruEntry *) cache->order->last_node);
+    }
+    cache->order->free(cache->order);
+    free(cache->slots);
+    free(cache);
+}
+
+LruCache *lru_new(size_t capacity)
+{
+    LruCache *cache = malloc(sizeof(LruCache));
+    size_t size = 2;
+
+    capacity = capacity ? capacity : 1;
+    /** Keeps the load factor at most 0.5, the table never grows because the capacity is bounded */
+    while (size < capacity * 2) {
+        size <<= 1;
+    }
+    cache->order = list_new();
+    cache->capacity = capacity;
+    cache->slots = calloc(size, sizeof(LruEntry *));
+    cache->mask = size - 1;
+    cache->get = get;
+    cache->peek = peek;
+    cache->put = put;
+    cache->has = has;
+    cache->touch = touch;
+    cache->delete = delete;
+    cache->evict = evict;
+    cache->free = free_;
+    cache->hash = NULL;
+    cache->equals = NULL;
+    cache->release_key = NULL;
+    cache->release_item = cache->order->release_item;
+
+    return cache;
+}
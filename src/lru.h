@@ -0,0 +1,35 @@
+#ifndef ROGUE_CRAFT_LRU_H
+#define ROGUE_CRAFT_LRU_H
+
+
+#include "list.h"
+
+
+typedef struct LruCache LruCache;
+typedef struct LruEntry LruEntry;
+
+struct LruCache {
+    /** Recency order, the head is the most recently used, the last is the next to be evicted */
+    List *order;
+    size_t capacity;
+    void *(*get)(LruCache *, void *key);
+    void *(*peek)(LruCache *, void *key);
+    LruCache *(*put)(LruCache *, void *key, void *value);
+    bool (*has)(LruCache *, void *key);
+    bool (*touch)(LruCache *, void *key);
+    LruCache *(*delete)(LruCache *, void *key);
+    LruCache *(*evict)(LruCache *);
+    void (*free)(LruCache *);
+    Hash hash;
+    Equals equals;
+    Release release_key;
+    Release release_item;
+    LruEntry **slots;
+    size_t mask;
+};
+
+
+LruCache *lru_new(size_t capacity);
+
+
+#endif
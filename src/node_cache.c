@@ -0,0 +1,243 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "node_cache.h"
+
+
+#define CLASS_COUNT 4
+#define CLASS_LARGE CLASS_COUNT
+#define MIN_CLASS_SIZE 32
+#define BATCH_SIZE 64
+
+
+typedef union Header Header;
+typedef struct Block Block;
+
+/** Keeps the returned memory aligned as malloc's would be */
+union Header {
+    size_t class;
+    long double align;
+    void *pointer;
+};
+
+/** Overlays the payload of a released node, the smallest class is big enough for it */
+struct Block {
+    Block *next;
+    Block *next_batch;
+};
+
+typedef struct {
+    Block *head;
+    size_t count;
+} FreeList;
+
+typedef struct {
+    pthread_mutex_t mutex;
+    Block *batches;
+} Depot;
+
+
+static Depot DEPOTS[CLASS_COUNT] = {
+    {PTHREAD_MUTEX_INITIALIZER, NULL},
+    {PTHREAD_MUTEX_INITIALIZER, NULL},
+    {PTHREAD_MUTEX_INITIALIZER, NULL},
+    {PTHREAD_MUTEX_INITIALIZER, NULL}
+};
+
+static __thread FreeList CACHE[CLASS_COUNT];
+static __thread bool REGISTERED = false;
+
+static pthread_key_t THREAD_KEY;
+static pthread_once_t THREAD_KEY_ONCE = PTHREAD_ONCE_INIT;
+
+
+static size_t class_size(size_t class)
+{
+    return (size_t) MIN_CLASS_SIZE << class;
+}
+
+static size_t class_of(size_t size)
+{
+    size_t class = 0;
+
+    while (class < CLASS_COUNT && size > class_size(class)) {
+        class++;
+    }
+
+    return class;
+}
+
+static Header *header_of(void *node)
+{
+    return (Header *) node - 1;
+}
+
+static void depot_push(size_t class, Block *batch)
+{
+    Depot *depot = &DEPOTS[class];
+
+    pthread_mutex_lock(&depot->mutex);
+    batch->next_batch = depot->batches;
+    depot->batches = batch;
+    pthread_mutex_unlock(&depot->mutex);
+}
+
+static Block *depot_pop(size_t class)
+{
+    Depot *depot = &DEPOTS[class];
+    Block *batch;
+
+    pthread_mutex_lock(&depot->mutex);
+    batch = depot->batches;
+    if (batch) {
+        depot->batches = batch->next_batch;
+    }
+    pthread_mutex_unlock(&depot->mutex);
+
+    return batch;
+}
+
+/** Detaches at most count blocks from the thread's free list as one chain */
+static Block *cache_take(FreeList *list, size_t count)
+{
+    Block *batch = list->head, *last = batch;
+
+    if (NULL == batch) {
+        return NULL;
+    }
+    while (--count && last->next) {
+        last = last->next;
+    }
+    list->head = last->next;
+    last->next = NULL;
+
+    return batch;
+}
+
+static size_t chain_length(Block *block)
+{
+    size_t length = 0;
+
+    while (block) {
+        length++;
+        block = block->next;
+    }
+
+    return length;
+}
+
+static void cache_flush(void *unused)
+{
+    size_t class;
+    Block *batch;
+    (void) unused;
+
+    for (class = 0; class < CLASS_COUNT; class++) {
+        while ((batch = cache_take(&CACHE[class], BATCH_SIZE))) {
+            depot_push(class, batch);
+        }
+        CACHE[class].count = 0;
+    }
+}
+
+static void create_thread_key(void)
+{
+    pthread_key_create(&THREAD_KEY, cache_flush);
+}
+
+/** The key's destructor returns the thread's blocks to the depot when the thread exits */
+static void register_thread(void)
+{
+    pthread_once(&THREAD_KEY_ONCE, create_thread_key);
+    pthread_setspecific(THREAD_KEY, CACHE);
+    REGISTERED = true;
+}
+
+void *node_cache_alloc(size_t size)
+{
+    size_t class = class_of(size);
+    FreeList *list;
+    Header *header;
+    Block *block;
+
+    if (CLASS_LARGE == class) {
+        header = malloc(sizeof(Header) + size);
+        header->class = CLASS_LARGE;
+
+        return header + 1;
+    }
+    if (!REGISTERED) {
+        register_thread();
+    }
+    list = &CACHE[class];
+
+    if (NULL == list->head && (list->head = depot_pop(class))) {
+        list->count = chain_length(list->head);
+    }
+    if ((block = list->head)) {
+        list->head = block->next;
+        list->count--;
+
+        return block;
+    }
+    header = malloc(sizeof(Header) + class_size(class));
+    header->class = class;
+
+    return header + 1;
+}
+
+void node_cache_release(void *node)
+{
+    size_t class = header_of(node)->class;
+    FreeList *list;
+    Block *block = node;
+
+    if (CLASS_LARGE == class) {
+        free(header_of(node));
+        return;
+    }
+    if (!REGISTERED) {
+        register_thread();
+    }
+    list = &CACHE[class];
+    block->next = list->head;
+    list->head = block;
+
+    /** Keeps one batch for the thread, so alternating alloc and release won't bounce on the depot */
+    if (++list->count >= 2 * BATCH_SIZE) {
+        depot_push(class, cache_take(list, BATCH_SIZE));
+        list->count -= BATCH_SIZE;
+    }
+}
+
+void node_cache_flush(void)
+{
+    cache_flush(NULL);
+}
+
+static void free_chain(Block *block)
+{
+    Block *next;
+
+    while (block) {
+        next = block->next;
+        free(header_of(block));
+        block = next;
+    }
+}
+
+void node_cache_trim(void)
+{
+    size_t class;
+    Block *batch;
+
+    for (class = 0; class < CLASS_COUNT; class++) {
+        free_chain(CACHE[class].head);
+        CACHE[class].head = NULL;
+        CACHE[class].count = 0;
+
+        while ((batch = depot_pop(class))) {
+            free_chain(batch);
+        }
+    }
+}
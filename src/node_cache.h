@@ -0,0 +1,27 @@
+#ifndef ROGUE_CRAFT_NODE_CACHE_H
+#define ROGUE_CRAFT_NODE_CACHE_H
+
+
+#include <stddef.h>
+
+
+/**
+ * Thread caching node allocator, matching the Alloc and Release signatures:
+ *
+ *  list_set_allocators(node_cache_alloc, node_cache_release, NULL);
+ *
+ * Every thread keeps its own free lists, full batches are handed over to a global depot,
+ * so a node can be released on any thread, not just the one that allocated it.
+ */
+void *node_cache_alloc(size_t size);
+
+void node_cache_release(void *node);
+
+/** Hands over every node cached by the calling thread to the depot */
+void node_cache_flush(void);
+
+/** Frees the nodes cached by the calling thread and the depot to the system */
+void node_cache_trim(void);
+
+
+#endif
@@ -0,0 +1,385 @@
+#include <stdlib.h>
+#include "persistent_list.h"
+#include "list_internal.h"
+
+
+/** Weight balance parameters, a subtree can't be more than DELTA times heavier than its sibling */
+#define DELTA 3
+#define GAMMA 2
+
+
+/** Leaves hold the items, branches have both children */
+struct PersistentNode {
+    size_t refs;
+    size_t size;
+    PersistentNode *left;
+    PersistentNode *right;
+    void *value;
+};
+
+
+static PersistentList *version_new(PersistentList *from, PersistentNode *root);
+
+
+static size_t weight(PersistentNode *node)
+{
+    return node ? node->size : 0;
+}
+
+static bool is_leaf(PersistentNode *node)
+{
+    return NULL == node->left;
+}
+
+static PersistentNode *retain_node(PersistentNode *node)
+{
+    if (node) {
+        __sync_fetch_and_add(&node->refs, 1);
+    }
+
+    return node;
+}
+
+static void release(PersistentList *list, PersistentNode *node)
+{
+    if (node && 0 == __sync_sub_and_fetch(&node->refs, 1)) {
+        if (is_leaf(node)) {
+            if (list->release_item) {
+                list->release_item(node->value);
+            }
+        } else {
+            release(list, node->left);
+            release(list, node->right);
+        }
+        list->release_node(node);
+    }
+}
+
+static PersistentNode *leaf(PersistentList *list, void *value)
+{
+    PersistentNode *node = list->alloc_node(sizeof(PersistentNode));
+    node->refs = 1;
+    node->size = 1;
+    node->left = node->right = NULL;
+    node->value = value;
+
+    return node;
+}
+
+/** Takes over the references of the children */
+static PersistentNode *branch(PersistentList *list, PersistentNode *left, PersistentNode *right)
+{
+    PersistentNode *node = list->alloc_node(sizeof(PersistentNode));
+    node->refs = 1;
+    node->size = left->size + right->size;
+    node->left = left;
+    node->right = right;
+    node->value = NULL;
+
+    return node;
+}
+
+/** Takes the children of a branch, and gives up the reference to the branch itself */
+static void split(PersistentList *list, PersistentNode *node, PersistentNode **left, PersistentNode **right)
+{
+    *left = retain_node(node->left);
+    *right = retain_node(node->right);
+    release(list, node);
+}
+
+static PersistentNode *rotate_left(PersistentList *list, PersistentNode *left, PersistentNode *right)
+{
+    PersistentNode *middle, *outer, *inner_left, *inner_right;
+
+    split(list, right, &middle, &outer);
+    if (weight(middle) < GAMMA * weight(outer) || is_leaf(middle)) {
+        return branch(list, branch(list, left, middle), outer);
+    }
+    split(list, middle, &inner_left, &inner_right);
+
+    return branch(list, branch(list, left, inner_left), branch(list, inner_right, outer));
+}
+
+static PersistentNode *rotate_right(PersistentList *list, PersistentNode *left, PersistentNode *right)
+{
+    PersistentNode *outer, *middle, *inner_left, *inner_right;
+
+    split(list, left, &outer, &middle);
+    if (weight(middle) < GAMMA * weight(outer) || is_leaf(middle)) {
+        return branch(list, outer, branch(list, middle, right));
+    }
+    split(list, middle, &inner_left, &inner_right);
+
+    return branch(list, branch(list, outer, inner_left), branch(list, inner_right, right));
+}
+
+/** Joins two subtrees, that got out of balance by at most one insertion or deletion */
+static PersistentNode *balance(PersistentList *list, PersistentNode *left, PersistentNode *right)
+{
+    if (weight(right) > DELTA * weight(left)) {
+        return rotate_left(list, left, right);
+    }
+    if (weight(left) > DELTA * weight(right)) {
+        return rotate_right(list, left, right);
+    }
+
+    return branch(list, left, right);
+}
+
+static PersistentNode *insert_node(PersistentList *list, PersistentNode *node, size_t index, PersistentNode *new)
+{
+    if (NULL == node) {
+        return new;
+    }
+    if (is_leaf(node)) {
+        return 0 == index ? branch(list, new, retain_node(node)) : branch(list, retain_node(node), new);
+    }
+    if (index <= weight(node->left)) {
+        return balance(list, insert_node(list, node->left, index, new), retain_node(node->right));
+    }
+
+    return balance(list, retain_node(node->left), insert_node(list, node->right, index - weight(node->left), new));
+}
+
+static PersistentNode *set_node(PersistentList *list, PersistentNode *node, size_t index, void *value)
+{
+    if (is_leaf(node)) {
+        return leaf(list, value);
+    }
+    if (index < weight(node->left)) {
+        return branch(list, set_node(list, node->left, index, value), retain_node(node->right));
+    }
+
+    return branch(list, retain_node(node->left), set_node(list, node->right, index - weight(node->left), value));
+}
+
+/** The sibling of the removed leaf takes the place of their parent */
+static PersistentNode *delete_node(PersistentList *list, PersistentNode *node, size_t index)
+{
+    if (is_leaf(node)) {
+        return NULL;
+    }
+    if (index < weight(node->left)) {
+        if (is_leaf(node->left)) {
+            return retain_node(node->right);
+        }
+        return balance(list, delete_node(list, node->left, index), retain_node(node->right));
+    }
+    if (is_leaf(node->right)) {
+        return retain_node(node->left);
+    }
+
+    return balance(list, retain_node(node->left), delete_node(list, node->right, index - weight(node->left)));
+}
+
+static PersistentNode *leaf_at(PersistentNode *node, size_t index)
+{
+    while (!is_leaf(node)) {
+        if (index < weight(node->left)) {
+            node = node->left;
+        } else {
+            index -= weight(node->left);
+            node = node->right;
+        }
+    }
+
+    return node;
+}
+
+/** Negative indexes count from the end, returns false if it's out of bounds */
+static bool resolve(PersistentList *list, ptrdiff_t index, size_t *resolved)
+{
+    int64_t i = index < 0 ? (int64_t) list->count + index : index;
+
+    if (i < 0 || i >= (int64_t) list->count) {
+        return false;
+    }
+    *resolved = (size_t) i;
+
+    return true;
+}
+
+static PersistentList *insert(PersistentList *list, ptrdiff_t index, void *value)
+{
+    size_t position = list->count;
+
+    if (index != (ptrdiff_t) list->count && !resolve(list, index, &position)) {
+        return version_new(list, retain_node(list->root));
+    }
+
+    return version_new(list, insert_node(list, list->root, position, leaf(list, value)));
+}
+
+static PersistentList *prepend(PersistentList *list, void *value)
+{
+    return version_new(list, insert_node(list, list->root, 0, leaf(list, value)));
+}
+
+static PersistentList *append(PersistentList *list, void *value)
+{
+    return version_new(list, insert_node(list, list->root, list->count, leaf(list, value)));
+}
+
+static PersistentList *set(PersistentList *list, ptrdiff_t index, void *value)
+{
+    size_t position;
+
+    if (!resolve(list, index, &position)) {
+        return version_new(list, retain_node(list->root));
+    }
+
+    return version_new(list, set_node(list, list->root, position, value));
+}
+
+static PersistentList *delete_at(PersistentList *list, ptrdiff_t index)
+{
+    size_t position;
+
+    if (!resolve(list, index, &position)) {
+        return version_new(list, retain_node(list->root));
+    }
+
+    return version_new(list, delete_node(list, list->root, position));
+}
+
+static void *get(PersistentList *list, ptrdiff_t index)
+{
+    size_t position;
+
+    return resolve(list, index, &position) ? leaf_at(list->root, position)->value : NULL;
+}
+
+static void *head(PersistentList *list)
+{
+    return list->get(list, 0);
+}
+
+static void *end(PersistentList *list)
+{
+    return list->get(list, -1);
+}
+
+/** Stops at the first leaf, the visitor returns true for */
+static bool walk(PersistentNode *node, bool reverse, bool (*visit)(void *))
+{
+    if (NULL == node) {
+        return false;
+    }
+    if (is_leaf(node)) {
+        return visit(node->value);
+    }
+    if (reverse) {
+        return walk(node->right, reverse, visit) || walk(node->left, reverse, visit);
+    }
+
+    return walk(node->left, reverse, visit) || walk(node->right, reverse, visit);
+}
+
+static PersistentList *foreach_l(PersistentList *list, Foreach foreach)
+{
+    walk(list->root, false, function(bool, (void *item) {
+        foreach(item);
+        return false;
+    }));
+
+    return list;
+}
+
+static PersistentList *foreach_r(PersistentList *list, Foreach foreach)
+{
+    walk(list->root, true, function(bool, (void *item) {
+        foreach(item);
+        return false;
+    }));
+
+    return list;
+}
+
+static void *fold_l(PersistentList *list, void *value, Fold fold)
+{
+    walk(list->root, false, function(bool, (void *item) {
+        value = fold(value, item);
+        return false;
+    }));
+
+    return value;
+}
+
+static void *fold_r(PersistentList *list, void *value, Fold fold)
+{
+    walk(list->root, true, function(bool, (void *item) {
+        value = fold(value, item);
+        return false;
+    }));
+
+    return value;
+}
+
+static void *find(PersistentList *list, Predicate predicate)
+{
+    void *found = NULL;
+
+    walk(list->root, false, function(bool, (void *item) {
+        if (predicate(item)) {
+            found = item;
+            return true;
+        }
+        return false;
+    }));
+
+    return found;
+}
+
+static bool exists(PersistentList *list, Predicate predicate)
+{
+    return walk(list->root, false, predicate);
+}
+
+/** A new handle for the same version, it's O(1) */
+static PersistentList *retain(PersistentList *list)
+{
+    return version_new(list, retain_node(list->root));
+}
+
+static void free_(PersistentList *list)
+{
+    release(list, list->root);
+    free(list);
+}
+
+static PersistentList *version_new(PersistentList *from, PersistentNode *root)
+{
+    PersistentList *list = malloc(sizeof(PersistentList));
+    list->root = root;
+    list->count = weight(root);
+    list->prepend = prepend;
+    list->append = append;
+    list->insert = insert;
+    list->set = set;
+    list->delete_at = delete_at;
+    list->get = get;
+    list->head = head;
+    list->last = end;
+    list->foreach_l = foreach_l;
+    list->foreach_r = foreach_r;
+    list->fold_l = fold_l;
+    list->fold_r = fold_r;
+    list->find = find;
+    list->exists = exists;
+    list->retain = retain;
+    list->free = free_;
+    list->release_item = from->release_item;
+    list->alloc_node = from->alloc_node;
+    list->release_node = from->release_node;
+
+    return list;
+}
+
+PersistentList *persistent_list_new(void)
+{
+    PersistentList defaults;
+
+    list_default_allocators(&defaults.alloc_node, &defaults.release_node, &defaults.release_item);
+
+    return version_new(&defaults, NULL);
+}
@@ -0,0 +1,45 @@
+#ifndef ROGUE_CRAFT_PERSISTENT_LIST_H
+#define ROGUE_CRAFT_PERSISTENT_LIST_H
+
+
+#include "list.h"
+
+
+typedef struct PersistentNode PersistentNode;
+typedef struct PersistentList PersistentList;
+
+/**
+ * An immutable version of a list, the modifying methods return a new version, sharing the unchanged
+ * nodes with the old one. Every version has to be freed on its own, the nodes are reference counted.
+ * The items are stored in the leaves of a weight balanced tree, so every operation is O(log n).
+ */
+struct PersistentList {
+    PersistentNode *root;
+    size_t count;
+    PersistentList *(*prepend)(PersistentList *, void *);
+    PersistentList *(*append)(PersistentList *, void *);
+    PersistentList *(*insert)(PersistentList *, ptrdiff_t, void *);
+    PersistentList *(*set)(PersistentList *, ptrdiff_t, void *);
+    PersistentList *(*delete_at)(PersistentList *, ptrdiff_t);
+    void *(*get)(PersistentList *, ptrdiff_t);
+    void *(*head)(PersistentList *);
+    void *(*last)(PersistentList *);
+    PersistentList *(*foreach_l)(PersistentList *, Foreach);
+    PersistentList *(*foreach_r)(PersistentList *, Foreach);
+    void *(*fold_l)(PersistentList *, void *, Fold);
+    void *(*fold_r)(PersistentList *, void *, Fold);
+    void *(*find)(PersistentList *, Predicate);
+    bool (*exists)(PersistentList *, Predicate);
+    PersistentList *(*retain)(PersistentList *);
+    void (*free)(PersistentList *);
+    Release release_item;
+    Alloc alloc_node;
+    Release release_node;
+};
+
+
+/** The allocators are taken from the defaults set by list_set_allocators(), and inherited by the new versions */
+PersistentList *persistent_list_new(void);
+
+
+#endif
@@ -0,0 +1,345 @@
+#include <stdlib.h>
+#include <sched.h>
+#include "rcu_list.h"
+#include "list_internal.h"
+
+
+#define CACHE_LINE 64
+
+
+struct RcuNode {
+    RcuNode *next;
+    void *value;
+};
+
+
+/** The readers registered by the calling thread, of any list */
+static __thread RcuReader *THREAD_READERS = NULL;
+
+
+#define load(pointer) __atomic_load_n(&(pointer), __ATOMIC_ACQUIRE)
+#define publish(pointer, value) __atomic_store_n(&(pointer), value, __ATOMIC_RELEASE)
+
+#define rcu_walk(list, ...)                                     \
+        RcuNode *node = load(list->head_node);                  \
+        while (node) {                                          \
+            __VA_ARGS__;                                        \
+            node = load(node->next);                            \
+        }                                                       \
+
+
+static RcuReader *register_reader(RcuList *list)
+{
+    RcuReader *reader;
+
+    /** A separate cache line, so the readers' stores won't bounce each other's */
+    if (posix_memalign((void **) &reader, CACHE_LINE, sizeof(RcuReader) < CACHE_LINE ? CACHE_LINE : sizeof(RcuReader))) {
+        return NULL;
+    }
+    reader->list = list;
+    reader->thread_next = THREAD_READERS;
+    THREAD_READERS = reader;
+
+    pthread_mutex_lock(&list->writer);
+    reader->next = list->readers;
+    list->readers = reader;
+    rcu_online(reader);
+    pthread_mutex_unlock(&list->writer);
+
+    return reader;
+}
+
+static RcuList *unregister_reader(RcuList *list, RcuReader *reader)
+{
+    RcuReader **current;
+
+    for (current = &THREAD_READERS; *current; current = &(*current)->thread_next) {
+        if (*current == reader) {
+            *current = reader->thread_next;
+            break;
+        }
+    }
+    /** A writer holding the lock could wait for it meanwhile */
+    rcu_offline(reader);
+    pthread_mutex_lock(&list->writer);
+    for (current = &list->readers; *current; current = &(*current)->next) {
+        if (*current == reader) {
+            *current = reader->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&list->writer);
+    free(reader);
+
+    return list;
+}
+
+/**
+ * Takes the calling thread's reader of the list offline before locking it, otherwise two reader
+ * threads writing at once would wait for each other. It can't be inside a traversal meanwhile.
+ */
+static RcuReader *writer_lock(RcuList *list)
+{
+    RcuReader *reader;
+
+    for (reader = THREAD_READERS; reader && reader->list != list; reader = reader->thread_next);
+    if (reader && RCU_OFFLINE != reader->epoch) {
+        rcu_offline(reader);
+    } else {
+        reader = NULL;
+    }
+    pthread_mutex_lock(&list->writer);
+
+    return reader;
+}
+
+/** Brings the reader taken offline by writer_lock() back online */
+static void writer_unlock(RcuList *list, RcuReader *reader)
+{
+    pthread_mutex_unlock(&list->writer);
+    if (reader) {
+        rcu_online(reader);
+    }
+}
+
+/**
+ * Waits until every online reader passed a quiescent state after the changes made so far,
+ * the writer lock has to be held.
+ */
+static void wait_for_readers(RcuList *list)
+{
+    uint64_t target = __atomic_add_fetch(&list->epoch, 1, __ATOMIC_SEQ_CST), epoch;
+    RcuReader *reader;
+
+    for (reader = list->readers; reader; reader = reader->next) {
+        while (RCU_OFFLINE != (epoch = load(reader->epoch)) && epoch < target) {
+            sched_yield();
+        }
+    }
+}
+
+static RcuList *synchronize(RcuList *list)
+{
+    RcuReader *self = writer_lock(list);
+
+    wait_for_readers(list);
+    writer_unlock(list, self);
+
+    return list;
+}
+
+static RcuNode *node_new(RcuList *list, void *value, RcuNode *next)
+{
+    RcuNode *node = list->alloc_node(sizeof(RcuNode));
+    node->value = value;
+    node->next = next;
+
+    return node;
+}
+
+static RcuList *prepend(RcuList *list, void *value)
+{
+    RcuReader *self = writer_lock(list);
+    RcuNode *node = node_new(list, value, list->head_node);
+
+    if (NULL == list->last_node) {
+        list->last_node = node;
+    }
+    publish(list->head_node, node);
+    list->count++;
+    writer_unlock(list, self);
+
+    return list;
+}
+
+static RcuList *append(RcuList *list, void *value)
+{
+    RcuReader *self = writer_lock(list);
+    RcuNode *node = node_new(list, value, NULL);
+
+    if (list->last_node) {
+        publish(list->last_node->next, node);
+    } else {
+        publish(list->head_node, node);
+    }
+    list->last_node = node;
+    list->count++;
+    writer_unlock(list, self);
+
+    return list;
+}
+
+static RcuList *replace(RcuList *list, void *from, void *to)
+{
+    RcuReader *self = writer_lock(list);
+    RcuNode *node;
+    bool replaced = false;
+
+    for (node = list->head_node; node; node = node->next) {
+        if (from == node->value) {
+            publish(node->value, to);
+            replaced = true;
+        }
+    }
+    if (replaced && list->release_item) {
+        wait_for_readers(list);
+        list->release_item(from);
+    }
+    writer_unlock(list, self);
+
+    return list;
+}
+
+static RcuList *delete(RcuList *list, void *item)
+{
+    RcuReader *self = writer_lock(list);
+    RcuNode *node, *prev = NULL;
+
+    for (node = list->head_node; node; prev = node, node = node->next) {
+        if (item == node->value) {
+            break;
+        }
+    }
+    if (node) {
+        if (prev) {
+            publish(prev->next, node->next);
+        } else {
+            publish(list->head_node, node->next);
+        }
+        if (node == list->last_node) {
+            list->last_node = prev;
+        }
+        list->count--;
+
+        /** Readers already on the node can still step to the next one, only after them it can go */
+        wait_for_readers(list);
+        if (list->release_item) {
+            list->release_item(node->value);
+        }
+        list->release_node(node);
+    }
+    writer_unlock(list, self);
+
+    return list;
+}
+
+/** Removes the head under the writer lock, the item is returned, not released */
+static void *shift(RcuList *list)
+{
+    RcuReader *self = writer_lock(list);
+    RcuNode *node;
+    void *value = NULL;
+
+    node = list->head_node;
+    if (node) {
+        publish(list->head_node, node->next);
+        if (node == list->last_node) {
+            list->last_node = NULL;
+        }
+        list->count--;
+        value = node->value;
+
+        wait_for_readers(list);
+        list->release_node(node);
+    }
+    writer_unlock(list, self);
+
+    return value;
+}
+
+static void *head(RcuList *list)
+{
+    RcuNode *node = load(list->head_node);
+
+    return node ? load(node->value) : NULL;
+}
+
+static RcuList *foreach_l(RcuList *list, Foreach foreach)
+{
+    rcu_walk(list, foreach(load(node->value)));
+
+    return list;
+}
+
+static void *fold_l(RcuList *list, void *value, Fold fold)
+{
+    rcu_walk(list, value = fold(value, load(node->value)));
+
+    return value;
+}
+
+static void *find(RcuList *list, Predicate predicate)
+{
+    void *value;
+
+    rcu_walk(list,
+             value = load(node->value);
+             if (predicate(value)) return value;
+    )
+
+    return NULL;
+}
+
+static bool exists(RcuList *list, Predicate predicate)
+{
+    rcu_walk(list,
+             if (predicate(load(node->value))) return true;
+    )
+
+    return false;
+}
+
+static bool has(RcuList *list, void *searched)
+{
+    rcu_walk(list,
+             if (searched == load(node->value)) return true;
+    )
+
+    return false;
+}
+
+/** Every reader has to be unregistered before */
+static void free_(RcuList *list)
+{
+    RcuNode *node = list->head_node, *next;
+
+    while (node) {
+        next = node->next;
+        if (list->release_item) {
+            list->release_item(node->value);
+        }
+        list->release_node(node);
+        node = next;
+    }
+    pthread_mutex_destroy(&list->writer);
+    free(list);
+}
+
+RcuList *rcu_list_new(void)
+{
+    RcuList *list = malloc(sizeof(RcuList));
+    list->head_node = NULL;
+    list->last_node = NULL;
+    list->count = 0;
+    list->epoch = RCU_OFFLINE + 1;
+    list->readers = NULL;
+    pthread_mutex_init(&list->writer, NULL);
+    list->register_reader = register_reader;
+    list->unregister_reader = unregister_reader;
+    list->prepend = prepend;
+    list->append = append;
+    list->replace = replace;
+    list->delete = delete;
+    list->shift = shift;
+    list->synchronize = synchronize;
+    list->head = head;
+    list->foreach_l = foreach_l;
+    list->fold_l = fold_l;
+    list->find = find;
+    list->exists = exists;
+    list->has = has;
+    list->free = free_;
+    list_default_allocators(&list->alloc_node, &list->release_node, &list->release_item);
+
+    return list;
+}
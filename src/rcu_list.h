@@ -0,0 +1,79 @@
+#ifndef ROGUE_CRAFT_RCU_LIST_H
+#define ROGUE_CRAFT_RCU_LIST_H
+
+
+#include <pthread.h>
+#include "list.h"
+
+
+typedef struct RcuNode RcuNode;
+typedef struct RcuList RcuList;
+typedef struct RcuReader RcuReader;
+
+#define RCU_OFFLINE 0
+
+/**
+ * Read-copy-update list for read mostly data. Readers traverse it without locks, and announce with
+ * rcu_quiescent() when they don't hold any item or node of it anymore, for example after each request.
+ * Writers are serialized, and wait until every online reader passed a quiescent state, before
+ * releasing the removed nodes and items. A registered reader can write too, its reader is taken
+ * offline while it waits for the lock and the other readers, so it has to be unregistered by the
+ * thread that registered it.
+ */
+struct RcuReader {
+    uint64_t epoch;
+    RcuList *list;
+    RcuReader *next;
+    RcuReader *thread_next;
+};
+
+struct RcuList {
+    RcuNode *head_node;
+    RcuNode *last_node;
+    size_t count;
+    uint64_t epoch;
+    RcuReader *readers;
+    pthread_mutex_t writer;
+    RcuReader *(*register_reader)(RcuList *);
+    RcuList *(*unregister_reader)(RcuList *, RcuReader *);
+    RcuList *(*prepend)(RcuList *, void *);
+    RcuList *(*append)(RcuList *, void *);
+    RcuList *(*replace)(RcuList *, void *, void *);
+    RcuList *(*delete)(RcuList *, void *);
+    void *(*shift)(RcuList *);
+    RcuList *(*synchronize)(RcuList *);
+    void *(*head)(RcuList *);
+    RcuList *(*foreach_l)(RcuList *, Foreach);
+    void *(*fold_l)(RcuList *, void *, Fold);
+    void *(*find)(RcuList *, Predicate);
+    bool (*exists)(RcuList *, Predicate);
+    bool (*has)(RcuList *, void *);
+    void (*free)(RcuList *);
+    Release release_item;
+    Alloc alloc_node;
+    Release release_node;
+};
+
+
+RcuList *rcu_list_new(void);
+
+/** A plain store on the reader's own cache line, no locks or read-modify-write */
+static inline void rcu_quiescent(RcuReader *reader)
+{
+    __atomic_store_n(&reader->epoch, __atomic_load_n(&reader->list->epoch, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+}
+
+/** Writers won't wait for an offline reader, it must not touch the list until it's online again */
+static inline void rcu_offline(RcuReader *reader)
+{
+    __atomic_store_n(&reader->epoch, RCU_OFFLINE, __ATOMIC_RELEASE);
+}
+
+static inline void rcu_online(RcuReader *reader)
+{
+    rcu_quiescent(reader);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+
+#endif
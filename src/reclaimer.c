@@ -0,0 +1,190 @@
+#include <stdlib.h>
+#include "reclaimer.h"
+
+
+#define DEFAULT_BATCH_SIZE 1024
+
+
+struct ReclaimBatch {
+    void **entries;
+    size_t count;
+    ReleaseBatch release;
+    ReclaimBatch *next;
+};
+
+
+static ReclaimBatch *batch_new(Reclaimer *reclaimer, ReleaseBatch release)
+{
+    ReclaimBatch *batch = malloc(sizeof(ReclaimBatch));
+    batch->entries = malloc(reclaimer->batch_size * sizeof(void *));
+    batch->count = 0;
+    batch->release = release;
+    batch->next = NULL;
+
+    return batch;
+}
+
+static void batch_run(ReclaimBatch *batch)
+{
+    if (batch->count) {
+        batch->release(batch->entries, batch->count);
+    }
+    free(batch->entries);
+    free(batch);
+}
+
+/** Hands the batch over to the background thread, or releases it right away */
+static void batch_submit(Reclaimer *reclaimer, ReclaimBatch *batch)
+{
+    if (!reclaimer->background) {
+        batch->release(batch->entries, batch->count);
+        batch->count = 0;
+        return;
+    }
+    pthread_mutex_lock(&reclaimer->mutex);
+    batch->next = reclaimer->pending;
+    reclaimer->pending = batch;
+    pthread_cond_signal(&reclaimer->ready);
+    pthread_mutex_unlock(&reclaimer->mutex);
+}
+
+static ReclaimBatch *batch_swap(Reclaimer *reclaimer, ReclaimBatch **slot)
+{
+    ReclaimBatch *full = *slot;
+
+    if (reclaimer->background) {
+        *slot = batch_new(reclaimer, full->release);
+    }
+
+    return full;
+}
+
+/** The pending batches are pushed as a stack, this restores their submission order */
+static ReclaimBatch *batch_reverse(ReclaimBatch *batch)
+{
+    ReclaimBatch *reversed = NULL, *next;
+
+    while (batch) {
+        next = batch->next;
+        batch->next = reversed;
+        reversed = batch;
+        batch = next;
+    }
+
+    return reversed;
+}
+
+static void *reclaim(void *arg)
+{
+    Reclaimer *reclaimer = arg;
+    ReclaimBatch *batch, *next;
+
+    pthread_mutex_lock(&reclaimer->mutex);
+    while (true) {
+        while (NULL == reclaimer->pending && !reclaimer->stopping) {
+            pthread_cond_wait(&reclaimer->ready, &reclaimer->mutex);
+        }
+        batch = reclaimer->pending;
+        reclaimer->pending = NULL;
+        if (NULL == batch && reclaimer->stopping) {
+            break;
+        }
+        pthread_mutex_unlock(&reclaimer->mutex);
+
+        batch = batch_reverse(batch);
+        while (batch) {
+            next = batch->next;
+            batch_run(batch);
+            batch = next;
+        }
+        pthread_mutex_lock(&reclaimer->mutex);
+    }
+    pthread_mutex_unlock(&reclaimer->mutex);
+
+    return NULL;
+}
+
+static void defer(Reclaimer *reclaimer, ReclaimBatch **slot, void *entry)
+{
+    ReclaimBatch *batch = *slot;
+
+    batch->entries[batch->count++] = entry;
+
+    if (batch->count == reclaimer->batch_size) {
+        batch_submit(reclaimer, batch_swap(reclaimer, slot));
+    }
+}
+
+static Reclaimer *defer_item(Reclaimer *reclaimer, void *item)
+{
+    defer(reclaimer, &reclaimer->items, item);
+
+    return reclaimer;
+}
+
+static Reclaimer *defer_node(Reclaimer *reclaimer, void *node)
+{
+    defer(reclaimer, &reclaimer->nodes, node);
+
+    return reclaimer;
+}
+
+/** The items are always released before their nodes */
+static Reclaimer *flush(Reclaimer *reclaimer)
+{
+    if (reclaimer->items && reclaimer->items->count) {
+        batch_submit(reclaimer, batch_swap(reclaimer, &reclaimer->items));
+    }
+    if (reclaimer->nodes && reclaimer->nodes->count) {
+        batch_submit(reclaimer, batch_swap(reclaimer, &reclaimer->nodes));
+    }
+
+    return reclaimer;
+}
+
+static void free_(Reclaimer *reclaimer)
+{
+    reclaimer->flush(reclaimer);
+
+    if (reclaimer->background) {
+        pthread_mutex_lock(&reclaimer->mutex);
+        reclaimer->stopping = true;
+        pthread_cond_signal(&reclaimer->ready);
+        pthread_mutex_unlock(&reclaimer->mutex);
+        pthread_join(reclaimer->thread, NULL);
+    }
+    if (reclaimer->items) {
+        batch_run(reclaimer->items);
+    }
+    if (reclaimer->nodes) {
+        batch_run(reclaimer->nodes);
+    }
+    pthread_cond_destroy(&reclaimer->ready);
+    pthread_mutex_destroy(&reclaimer->mutex);
+    free(reclaimer);
+}
+
+Reclaimer *reclaimer_new(ReleaseBatch release_items, ReleaseBatch release_nodes, size_t batch_size, bool background)
+{
+    Reclaimer *reclaimer = malloc(sizeof(Reclaimer));
+    reclaimer->batch_size = batch_size ? batch_size : DEFAULT_BATCH_SIZE;
+    reclaimer->release_items = release_items;
+    reclaimer->release_nodes = release_nodes;
+    reclaimer->items = release_items ? batch_new(reclaimer, release_items) : NULL;
+    reclaimer->nodes = release_nodes ? batch_new(reclaimer, release_nodes) : NULL;
+    reclaimer->defer_item = defer_item;
+    reclaimer->defer_node = defer_node;
+    reclaimer->flush = flush;
+    reclaimer->free = free_;
+    reclaimer->background = background;
+    reclaimer->stopping = false;
+    reclaimer->pending = NULL;
+    pthread_mutex_init(&reclaimer->mutex, NULL);
+    pthread_cond_init(&reclaimer->ready, NULL);
+
+    if (background) {
+        pthread_create(&reclaimer->thread, NULL, reclaim, reclaimer);
+    }
+
+    return reclaimer;
+}
@@ -0,0 +1,43 @@
+#ifndef ROGUE_CRAFT_RECLAIMER_H
+#define ROGUE_CRAFT_RECLAIMER_H
+
+
+#include <pthread.h>
+#include "list.h"
+
+
+typedef void (*ReleaseBatch)(void **, size_t);
+typedef struct ReclaimBatch ReclaimBatch;
+
+/**
+ * Collects the released items and nodes of the Lists it's assigned to, and hands them over
+ * to the batch callbacks, optionally on a background thread. A Reclaimer must not be used
+ * by more than one thread at a time, only the releasing is done concurrently.
+ */
+struct Reclaimer {
+    ReclaimBatch *items;
+    ReclaimBatch *nodes;
+    size_t batch_size;
+    ReleaseBatch release_items;
+    ReleaseBatch release_nodes;
+    Reclaimer *(*defer_item)(Reclaimer *, void *);
+    Reclaimer *(*defer_node)(Reclaimer *, void *);
+    Reclaimer *(*flush)(Reclaimer *);
+    void (*free)(Reclaimer *);
+    bool background;
+    bool stopping;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t ready;
+    ReclaimBatch *pending;
+};
+
+
+/**
+ * If a callback is NULL, that kind is not deferred, the List releases it on its own,
+ * as it does without a Reclaimer
+ */
+Reclaimer *reclaimer_new(ReleaseBatch release_items, ReleaseBatch release_nodes, size_t batch_size, bool background);
+
+
+#endif
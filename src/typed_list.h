@@ -0,0 +1,307 @@
+#ifndef ROGUE_CRAFT_TYPED_LIST_H
+#define ROGUE_CRAFT_TYPED_LIST_H
+
+/**
+ * Header only, type specialized doubly linked list. The values are stored in the nodes, and the
+ * operations are static inline functions, so the callbacks can be inlined at the call site:
+ *
+ *  LIST_DEFINE(int_list, int)
+ *
+ *  int_list *list = int_list_new();
+ *  int_list_append(list, 10);
+ *
+ * The method names mirror List's ones, with the name of the list type as their prefix.
+ */
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+
+#ifndef TYPED_LIST_ALLOC
+#define TYPED_LIST_ALLOC malloc
+#endif
+
+#ifndef TYPED_LIST_RELEASE
+#define TYPED_LIST_RELEASE free
+#endif
+
+
+#define LIST_DEFINE(name, type)                                                     \
+                                                                                    \
+typedef struct name##_node name##_node;                                             \
+typedef struct name name;                                                           \
+                                                                                    \
+struct name##_node {                                                                \
+    name##_node *next;                                                              \
+    name##_node *prev;                                                              \
+    type value;                                                                     \
+};                                                                                  \
+                                                                                    \
+struct name {                                                                       \
+    name##_node *head_node;                                                         \
+    name##_node *last_node;                                                         \
+    size_t count;                                                                   \
+};                                                                                  \
+                                                                                    \
+static inline void name##_init(name *list)                                          \
+{                                                                                   \
+    list->head_node = list->last_node = NULL;                                       \
+    list->count = 0;                                                                \
+}                                                                                   \
+                                                                                    \
+static inline name *name##_new(void)                                                \
+{                                                                                   \
+    name *list = TYPED_LIST_ALLOC(sizeof(name));                                    \
+    name##_init(list);                                                              \
+                                                                                    \
+    return list;                                                                    \
+}                                                                                   \
+                                                                                    \
+static inline name##_node *name##_node_new(type value)                              \
+{                                                                                   \
+    name##_node *node = TYPED_LIST_ALLOC(sizeof(name##_node));                      \
+    node->value = value;                                                            \
+                                                                                    \
+    return node;                                                                    \
+}                                                                                   \
+                                                                                    \
+static inline name *name##_prepend(name *list, type value)                          \
+{                                                                                   \
+    name##_node *node = name##_node_new(value);                                     \
+    node->prev = NULL;                                                              \
+    node->next = list->head_node;                                                   \
+                                                                                    \
+    if (list->head_node) {                                                          \
+        list->head_node->prev = node;                                               \
+    } else {                                                                        \
+        list->last_node = node;                                                     \
+    }                                                                               \
+    list->head_node = node;                                                         \
+    list->count++;                                                                  \
+                                                                                    \
+    return list;                                                                    \
+}                                                                                   \
+                                                                                    \
+static inline name *name##_append(name *list, type value)                           \
+{                                                                                   \
+    name##_node *node = name##_node_new(value);                                     \
+    node->next = NULL;                                                              \
+    node->prev = list->last_node;                                                   \
+                                                                                    \
+    if (list->last_node) {                                                          \
+        list->last_node->next = node;                                               \
+    } else {                                                                        \
+        list->head_node = node;                                                     \
+    }                                                                               \
+    list->last_node = node;                                                         \
+    list->count++;                                                                  \
+                                                                                    \
+    return list;                                                                    \
+}                                                                                   \
+                                                                                    \
+static inline void name##_delete_node(name *list, name##_node *node)                \
+{                                                                                   \
+    if (node->prev) {                                                               \
+        node->prev->next = node->next;                                              \
+    } else {                                                                        \
+        list->head_node = node->next;                                               \
+    }                                                                               \
+    if (node->next) {                                                               \
+        node->next->prev = node->prev;                                              \
+    } else {                                                                        \
+        list->last_node = node->prev;                                               \
+    }                                                                               \
+    TYPED_LIST_RELEASE(node);                                                       \
+    list->count--;                                                                  \
+}                                                                                   \
+                                                                                    \
+/** Returns false if the list is empty, otherwise the value is copied to out */     \
+static inline bool name##_shift(name *list, type *out)                              \
+{                                                                                   \
+    if (NULL == list->head_node) {                                                  \
+        return false;                                                               \
+    }                                                                               \
+    if (out) {                                                                      \
+        *out = list->head_node->value;                                              \
+    }                                                                               \
+    name##_delete_node(list, list->head_node);                                      \
+                                                                                    \
+    return true;                                                                    \
+}                                                                                   \
+                                                                                    \
+static inline bool name##_pop(name *list, type *out)                                \
+{                                                                                   \
+    if (NULL == list->last_node) {                                                  \
+        return false;                                                               \
+    }                                                                               \
+    if (out) {                                                                      \
+        *out = list->last_node->value;                                              \
+    }                                                                               \
+    name##_delete_node(list, list->last_node);                                      \
+                                                                                    \
+    return true;                                                                    \
+}                                                                                   \
+                                                                                    \
+static inline type *name##_head(name *list)                                         \
+{                                                                                   \
+    return list->head_node ? &list->head_node->value : NULL;                        \
+}                                                                                   \
+                                                                                    \
+static inline type *name##_last(name *list)                                         \
+{                                                                                   \
+    return list->last_node ? &list->last_node->value : NULL;                        \
+}                                                                                   \
+                                                                                    \
+static inline name##_node *name##_node_at(name *list, ptrdiff_t index)              \
+{                                                                                   \
+    name##_node *node;                                                              \
+                                                                                    \
+    if (index < 0) {                                                                \
+        for (node = list->last_node; node && ++index < 0; node = node->prev);      \
+    } else {                                                                        \
+        for (node = list->head_node; node && index-- > 0; node = node->next);      \
+    }                                                                               \
+                                                                                    \
+    return node;                                                                    \
+}                                                                                   \
+                                                                                    \
+/** Returns a pointer to the stored value, NULL if the index is out of bounds */    \
+static inline type *name##_get(name *list, ptrdiff_t index)                         \
+{                                                                                   \
+    name##_node *node = name##_node_at(list, index);                                \
+                                                                                    \
+    return node ? &node->value : NULL;                                              \
+}                                                                                   \
+                                                                                    \
+static inline name *name##_set(name *list, ptrdiff_t index, type value)             \
+{                                                                                   \
+    name##_node *node = name##_node_at(list, index);                                \
+                                                                                    \
+    if (node) {                                                                     \
+        node->value = value;                                                        \
+    }                                                                               \
+                                                                                    \
+    return list;                                                                    \
+}                                                                                   \
+                                                                                    \
+static inline name *name##_delete_at(name *list, ptrdiff_t index)                   \
+{                                                                                   \
+    name##_node *node = name##_node_at(list, index);                                \
+                                                                                    \
+    if (node) {                                                                     \
+        name##_delete_node(list, node);                                             \
+    }                                                                               \
+                                                                                    \
+    return list;                                                                    \
+}                                                                                   \
+                                                                                    \
+static inline name *name##_foreach_l(name *list, void (*foreach)(type *))           \
+{                                                                                   \
+    name##_node *node;                                                              \
+                                                                                    \
+    for (node = list->head_node; node; node = node->next) {                         \
+        foreach(&node->value);                                                      \
+    }                                                                               \
+                                                                                    \
+    return list;                                                                    \
+}                                                                                   \
+                                                                                    \
+static inline name *name##_foreach_r(name *list, void (*foreach)(type *))           \
+{                                                                                   \
+    name##_node *node;                                                              \
+                                                                                    \
+    for (node = list->last_node; node; node = node->prev) {                         \
+        foreach(&node->value);                                                      \
+    }                                                                               \
+                                                                                    \
+    return list;                                                                    \
+}                                                                                   \
+                                                                                    \
+static inline name *name##_map(name *list, type (*mapper)(type))                    \
+{                                                                                   \
+    name##_node *node;                                                              \
+                                                                                    \
+    for (node = list->head_node; node; node = node->next) {                         \
+        node->value = mapper(node->value);                                          \
+    }                                                                               \
+                                                                                    \
+    return list;                                                                    \
+}                                                                                   \
+                                                                                    \
+static inline name *name##_filter(name *list, bool (*predicate)(type *))            \
+{                                                                                   \
+    name##_node *node = list->head_node, *next;                                     \
+                                                                                    \
+    while (node) {                                                                  \
+        next = node->next;                                                          \
+        if (!predicate(&node->value)) {                                             \
+            name##_delete_node(list, node);                                         \
+        }                                                                           \
+        node = next;                                                                \
+    }                                                                               \
+                                                                                    \
+    return list;                                                                    \
+}                                                                                   \
+                                                                                    \
+static inline type name##_fold_l(name *list, type value, type (*fold)(type, type))  \
+{                                                                                   \
+    name##_node *node;                                                              \
+                                                                                    \
+    for (node = list->head_node; node; node = node->next) {                         \
+        value = fold(value, node->value);                                           \
+    }                                                                               \
+                                                                                    \
+    return value;                                                                   \
+}                                                                                   \
+                                                                                    \
+static inline type name##_fold_r(name *list, type value, type (*fold)(type, type))  \
+{                                                                                   \
+    name##_node *node;                                                              \
+                                                                                    \
+    for (node = list->last_node; node; node = node->prev) {                         \
+        value = fold(value, node->value);                                           \
+    }                                                                               \
+                                                                                    \
+    return value;                                                                   \
+}                                                                                   \
+                                                                                    \
+static inline type *name##_find(name *list, bool (*predicate)(type *))              \
+{                                                                                   \
+    name##_node *node;                                                              \
+                                                                                    \
+    for (node = list->head_node; node; node = node->next) {                         \
+        if (predicate(&node->value)) {                                              \
+            return &node->value;                                                    \
+        }                                                                           \
+    }                                                                               \
+                                                                                    \
+    return NULL;                                                                    \
+}                                                                                   \
+                                                                                    \
+static inline bool name##_exists(name *list, bool (*predicate)(type *))             \
+{                                                                                   \
+    return NULL != name##_find(list, predicate);                                    \
+}                                                                                   \
+                                                                                    \
+/** Releases the nodes only, for lists embedded in other structs or on the stack */ \
+static inline void name##_clear(name *list)                                         \
+{                                                                                   \
+    name##_node *node = list->head_node, *next;                                     \
+                                                                                    \
+    while (node) {                                                                  \
+        next = node->next;                                                          \
+        TYPED_LIST_RELEASE(node);                                                   \
+        node = next;                                                                \
+    }                                                                               \
+    name##_init(list);                                                              \
+}                                                                                   \
+                                                                                    \
+static inline void name##_free(name *list)                                          \
+{                                                                                   \
+    name##_clear(list);                                                             \
+    TYPED_LIST_RELEASE(list);                                                       \
+}                                                                                   \
+
+
+#endif
@@ -0,0 +1,166 @@
+#include <stdlib.h>
+#include "ws_deque.h"
+#include "list_internal.h"
+
+
+#define CACHE_LINE 64
+#define MIN_CAPACITY 16
+
+
+/** Circular buffer, the items follow it in the same allocation */
+struct WsBuffer {
+    int64_t mask;
+    WsBuffer *next;
+};
+
+
+#define items_of(buffer) ((void **) (buffer + 1))
+
+#define load_item(buffer, i) __atomic_load_n(&items_of(buffer)[(i) & (buffer)->mask], __ATOMIC_RELAXED)
+#define store_item(buffer, i, item) __atomic_store_n(&items_of(buffer)[(i) & (buffer)->mask], item, __ATOMIC_RELAXED)
+
+
+static WsBuffer *buffer_new(int64_t capacity)
+{
+    WsBuffer *buffer = malloc(sizeof(WsBuffer) + capacity * sizeof(void *));
+    buffer->mask = capacity - 1;
+    buffer->next = NULL;
+
+    return buffer;
+}
+
+/** Thieves can still read the old buffer, so it's only retired, and freed with the deque */
+static WsBuffer *grow(WsDeque *deque, WsBuffer *buffer, int64_t top, int64_t bottom)
+{
+    WsBuffer *new = buffer_new(2 * (buffer->mask + 1));
+    int64_t i;
+
+    for (i = top; i < bottom; i++) {
+        store_item(new, i, load_item(buffer, i));
+    }
+    buffer->next = deque->retired;
+    deque->retired = buffer;
+    __atomic_store_n(&deque->buffer, new, __ATOMIC_RELEASE);
+
+    return new;
+}
+
+static WsDeque *append(WsDeque *deque, void *item)
+{
+    int64_t bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED);
+    int64_t top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+    WsBuffer *buffer = __atomic_load_n(&deque->buffer, __ATOMIC_RELAXED);
+
+    if (bottom - top > buffer->mask) {
+        buffer = grow(deque, buffer, top, bottom);
+    }
+    store_item(buffer, bottom, item);
+    /** Publishes the item to the thieves, a plain store on x86 */
+    __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELEASE);
+
+    return deque;
+}
+
+/** Only the last item can be taken by a thief at the same time, they race for it on the top */
+static void *pop(WsDeque *deque)
+{
+    int64_t bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED) - 1, top;
+    WsBuffer *buffer = __atomic_load_n(&deque->buffer, __ATOMIC_RELAXED);
+    void *item = NULL;
+
+    __atomic_store_n(&deque->bottom, bottom, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    top = __atomic_load_n(&deque->top, __ATOMIC_RELAXED);
+
+    if (top <= bottom) {
+        item = load_item(buffer, bottom);
+        if (top == bottom) {
+            if (!__atomic_compare_exchange_n(&deque->top, &top, top + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+                item = NULL;
+            }
+            __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+        }
+    } else {
+        __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+    }
+
+    return item;
+}
+
+/** Retries only if another thread took the item in the meantime, so it's lock free */
+static void *shift(WsDeque *deque)
+{
+    int64_t top, bottom;
+    WsBuffer *buffer;
+    void *item;
+
+    while (true) {
+        top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        bottom = __atomic_load_n(&deque->bottom, __ATOMIC_ACQUIRE);
+
+        if (top >= bottom) {
+            return NULL;
+        }
+        buffer = __atomic_load_n(&deque->buffer, __ATOMIC_ACQUIRE);
+        item = load_item(buffer, top);
+
+        if (__atomic_compare_exchange_n(&deque->top, &top, top + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+            return item;
+        }
+    }
+}
+
+/** Only a snapshot, if other threads are working on it */
+static size_t count(WsDeque *deque)
+{
+    int64_t size = __atomic_load_n(&deque->bottom, __ATOMIC_ACQUIRE) - __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+
+    return size > 0 ? (size_t) size : 0;
+}
+
+/** No other thread can use it anymore */
+static void free_(WsDeque *deque)
+{
+    WsBuffer *buffer, *next;
+    int64_t i;
+
+    if (deque->release_item) {
+        for (i = deque->top; i < deque->bottom; i++) {
+            deque->release_item(load_item(deque->buffer, i));
+        }
+    }
+    free(deque->buffer);
+    for (buffer = deque->retired; buffer; buffer = next) {
+        next = buffer->next;
+        free(buffer);
+    }
+    free(deque);
+}
+
+WsDeque *ws_deque_new(size_t capacity)
+{
+    WsDeque *deque;
+    Alloc alloc_node;
+    Release release_node;
+    size_t size = MIN_CAPACITY;
+
+    /** The owner's and the thieves' ends are on separate cache lines */
+    if (posix_memalign((void **) &deque, CACHE_LINE, sizeof(WsDeque))) {
+        return NULL;
+    }
+    while (size < capacity) {
+        size *= 2;
+    }
+    deque->top = deque->bottom = 0;
+    deque->buffer = buffer_new(size);
+    deque->retired = NULL;
+    deque->append = append;
+    deque->pop = pop;
+    deque->shift = shift;
+    deque->count = count;
+    deque->free = free_;
+    list_default_allocators(&alloc_node, &release_node, &deque->release_item);
+
+    return deque;
+}
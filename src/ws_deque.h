@@ -0,0 +1,36 @@
+#ifndef ROGUE_CRAFT_WS_DEQUE_H
+#define ROGUE_CRAFT_WS_DEQUE_H
+
+
+#include "list.h"
+
+
+typedef struct WsBuffer WsBuffer;
+typedef struct WsDeque WsDeque;
+
+/**
+ * Chase-Lev work stealing deque of tasks. Only the owner thread can append and pop at the end,
+ * without locks, any other thread can shift from the front, competing with a compare-and-swap.
+ * The items can't be NULL, that's returned when it's empty.
+ */
+struct WsDeque {
+    int64_t top;
+    char top_padding[64 - sizeof(int64_t)];
+    int64_t bottom;
+    WsBuffer *buffer;
+    WsBuffer *retired;
+    char bottom_padding[64 - sizeof(int64_t) - 2 * sizeof(void *)];
+    WsDeque *(*append)(WsDeque *, void *);
+    void *(*pop)(WsDeque *);
+    void *(*shift)(WsDeque *);
+    size_t (*count)(WsDeque *);
+    void (*free)(WsDeque *);
+    Release release_item;
+};
+
+
+/** The capacity is rounded up to a power of two, the buffer grows when needed */
+WsDeque *ws_deque_new(size_t capacity);
+
+
+#endif
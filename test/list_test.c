@@ -1,7 +1,18 @@
 #include <string.h>
 #include <stdlib.h>
+#include <pthread.h>
+#include <poll.h>
 #include "minunit.h"
 #include "../src/list.h"
+#include "../src/lru.h"
+#include "../src/node_cache.h"
+#include "../src/compact_list.h"
+#include "../src/typed_list.h"
+#include "../src/reclaimer.h"
+#include "../src/persistent_list.h"
+#include "../src/rcu_list.h"
+#include "../src/ws_deque.h"
+#include "../src/blocking_queue.h"
 
 
 MU_TEST(test_prepend)
@@ -127,6 +138,27 @@ MU_TEST(test_get_index)
     mu_assert_int_eq(a, *(int *) list->get(list, -3));
 
     mu_assert(NULL == list->get(list, 100), "This should be NULL");
+    mu_assert(NULL == list->get(list, -4), "This should be NULL");
+    mu_assert(NULL == list->get(list, PTRDIFF_MIN), "This should be NULL");
+    mu_assert(NULL == list->get(list, PTRDIFF_MAX), "This should be NULL");
+    list->set(list, PTRDIFF_MIN, &b)->delete_at(list, PTRDIFF_MIN);
+    mu_assert_int_eq(3, list->count);
+
+    list->set(list, -1, &a);
+    mu_assert_int_eq(3, list->count);
+    mu_assert_int_eq(a, *(int *) list->last(list));
+    mu_assert_int_eq(3, list->slice(list, PTRDIFF_MIN, PTRDIFF_MAX).count);
+    mu_assert(sizeof(size_t) == sizeof(list->count), "Should not be limited to 32 bits");
+
+    /** ~PTRDIFF_MAX is PTRDIFF_MIN */
+    list->flags |= LIST_REVERSED;
+    mu_assert(NULL == list->get(list, PTRDIFF_MAX), "This should be NULL");
+    mu_assert(NULL == list->get(list, PTRDIFF_MIN), "This should be NULL");
+    list_adapt(list, &(ListTuning) {1, 0, 0, 1, NULL});
+    list->get(list, 0);
+    mu_assert(list_mode(list) & LIST_MODE_INDEXED, "Should be indexed");
+    mu_assert(NULL == list->get(list, PTRDIFF_MAX), "This should be NULL");
+    mu_assert(NULL == list->get(list, PTRDIFF_MIN), "This should be NULL");
 
     list->free(list);
 }
@@ -178,6 +210,100 @@ MU_TEST(test_clone)
     new->free(new);
 }
 
+MU_TEST(test_clone_reversed)
+{
+    int items[4] = {1, 2, 3, 4}, i, out;
+    List *list = list_new(), *sized = list_new_sized(sizeof(int)), *new;
+
+    for (i = 0; i < 4; i++) {
+        list->append(list, &items[i]);
+        sized->append_copy(sized, &items[i]);
+    }
+    list->flags |= LIST_REVERSED;
+    sized->flags |= LIST_REVERSED;
+
+    new = list->clone(list);
+    mu_assert_int_eq(4, *(int *) new->head(new));
+    mu_assert_int_eq(3, *(int *) new->get(new, 1));
+    mu_assert_int_eq(1, *(int *) new->last(new));
+    new->free(new);
+
+    new = sized->clone(sized);
+    mu_assert(new->shift_copy(new, &out), "Should be copied");
+    mu_assert_int_eq(4, out);
+    mu_assert_int_eq(3, *(int *) new->head(new));
+    new->free(new);
+
+    list->free(list);
+    sized->free(sized);
+}
+
+MU_TEST(test_clone_cow)
+{
+    int a = 1, b = 2, c = 3, i;
+    List *list = list_new();
+    list->append(list, &a)->append(list, &b);
+
+    List *snapshot = list->clone_cow(list);
+    mu_assert(list->head_node == snapshot->head_node, "Should share the nodes");
+    mu_assert_int_eq(2, snapshot->count);
+
+    list->append(list, &c)->shift(list);
+    mu_assert(list->head_node != snapshot->head_node, "Should have its own nodes");
+    mu_assert_int_eq(2, list->count);
+    mu_assert_int_eq(3, *(int *) list->last(list));
+    mu_assert_int_eq(1, *(int *) snapshot->head(snapshot));
+    mu_assert_int_eq(2, *(int *) snapshot->last(snapshot));
+
+    List *other = snapshot->clone_cow(snapshot);
+    snapshot->free(snapshot);
+    other->delete(other, &a);
+    mu_assert_int_eq(1, other->count);
+    other->free(other);
+    list->free(list);
+
+    list = list_new();
+    list->release_item = free;
+    list->append(list, strdup("Test"));
+    snapshot = list->clone_cow(list);
+    list->free(list);
+    mu_assert_int_eq(0, strcmp("Test", snapshot->head(snapshot)));
+    /** The last one releases the items */
+    snapshot->free(snapshot);
+
+    /** After the owner is gone, the first one copying the nodes takes over the items */
+    list = list_new();
+    list->release_item = free;
+    list->append(list, strdup("Test"));
+    snapshot = list->clone_cow(list);
+    other = list->clone_cow(list);
+    list->free(list);
+    snapshot->append(snapshot, strdup("Unit"));
+    other->free(other);
+    mu_assert_int_eq(0, strcmp("Test", snapshot->head(snapshot)));
+    mu_assert(free == snapshot->release_item, "Should own the items");
+    snapshot->free(snapshot);
+
+    /** Concurrent snapshots publish a single share */
+    list = list_new();
+    list->append(list, &a);
+    pthread_t threads[4];
+    List *snapshots[4];
+    for (i = 0; i < 4; i++) {
+        pthread_create(&threads[i], NULL, function(void *, (void *shared) {
+            return ((List *) shared)->clone_cow(shared);
+        }), list);
+    }
+    for (i = 0; i < 4; i++) {
+        pthread_join(threads[i], (void **) &snapshots[i]);
+        mu_assert(list->share == snapshots[i]->share, "Should share");
+    }
+    for (i = 0; i < 4; i++) {
+        snapshots[i]->free(snapshots[i]);
+    }
+    list->free(list);
+}
+
 MU_TEST(test_delete)
 {
     List *list = list_new();
@@ -243,10 +369,457 @@ MU_TEST(test_merge)
 
     mu_assert_int_eq(3, list->count);
     mu_assert_int_eq(0, strcmp(common, list->get(list, 1)));
+    list->free(list);
+
+    /** Both add the other List's items in the order it's seen in */
+    list = list_new();
+    other = list_new();
+    other->append(other, "Test")->append(other, "Unit")->flags |= LIST_REVERSED;
+    list->merge(list, other);
+    mu_assert_int_eq(0, strcmp("Unit", list->head(list)));
+    list->concat(list, other);
+    mu_assert_int_eq(0, strcmp("Unit", list->get(list, 2)));
+    mu_assert_int_eq(0, strcmp("Test", list->last(list)));
+
+    list->free(list);
+    other->free(other);
+}
+
+static uint64_t hash_string(void *item)
+{
+    uint64_t hash = 5381;
+    char *c;
 
+    for (c = item; *c; c++) {
+        hash = hash * 33 + *c;
+    }
+
+    return hash;
+}
+
+static bool strings_equal(void *a, void *b)
+{
+    return 0 == strcmp(a, b);
+}
+
+MU_TEST(test_set_operations)
+{
+    char *unit = "Unit";
+    char other_unit[] = "Unit";
+    char test_copy[] = "Test";
+    List *list = list_new();
+    List *other = list_new();
+    List *snapshot;
+
+    list->append(list, unit)->append(list, "Test")->append(list, unit)->distinct(list);
+    mu_assert_int_eq(2, list->count);
+
+    other->append(other, other_unit)->append(other, "Hello");
+    list->merge(list, other);
+    mu_assert_int_eq(4, list->count);
+
+    list->hash = hash_string;
+    list->equals = strings_equal;
+    list->distinct(list);
+    mu_assert_int_eq(3, list->count);
+    mu_assert(unit == list->head(list), "The first one should be kept");
+
+    list->intersect(list, other);
+    mu_assert_int_eq(2, list->count);
+    mu_assert_int_eq(0, strcmp("Hello", list->last(list)));
+
+    list->append(list, "Test")->difference(list, other);
+    mu_assert_int_eq(1, list->count);
+    mu_assert_int_eq(0, strcmp("Test", list->head(list)));
+
+    /** Unsharing keeps comparing by the callbacks */
+    snapshot = list->clone_cow(list);
+    list->append(list, test_copy)->distinct(list);
+    mu_assert_int_eq(1, list->count);
+    list->merge(list, other);
+    mu_assert_int_eq(3, list->count);
+    mu_assert(strings_equal == list->equals, "Should be kept");
+
+    list->free(list);
+    other->free(other);
+    snapshot->free(snapshot);
+
+    /** The repeated pointer of an equal item is released once */
+    list = list_new();
+    list->hash = hash_string;
+    list->equals = strings_equal;
+    list->release_item = free;
+    unit = strdup("Unit");
+    list->append(list, strdup("Unit"))->append(list, unit)->append(list, unit)->distinct(list);
+    mu_assert_int_eq(1, list->count);
     list->free(list);
 }
 
+MU_TEST(test_group_by)
+{
+    int items[10], i;
+    List *list = list_new(), *groups, *group, **partitions;
+
+    for (i = 0; i < 10; i++) {
+        items[i] = i;
+        list->append(list, &items[i]);
+    }
+    groups = list->group_by(list, (Key) function(void *, (int *item) {
+        return (void *) (uintptr_t) (*item % 3);
+    }), NULL, NULL);
+
+    mu_assert_int_eq(0, list->count);
+    mu_assert_int_eq(3, groups->count);
+    group = groups->get(groups, 0);
+    mu_assert_int_eq(4, group->count);
+    mu_assert_int_eq(9, *(int *) group->last(group));
+    group = groups->get(groups, 2);
+    mu_assert_int_eq(3, group->count);
+    mu_assert_int_eq(2, *(int *) group->head(group));
+
+    group = groups->get(groups, 1);
+    partitions = group->partition_by(group, (Bucket) function(size_t, (int *item) {
+        return *item < 4 ? 0 : 7 == *item ? 5 : 1;
+    }), 2);
+    mu_assert_int_eq(1, group->count);
+    mu_assert_int_eq(7, *(int *) group->head(group));
+    mu_assert_int_eq(1, partitions[0]->count);
+    mu_assert_int_eq(1, partitions[1]->count);
+    mu_assert_int_eq(4, *(int *) partitions[1]->last(partitions[1]));
+
+    partitions[0]->free(partitions[0]);
+    partitions[1]->free(partitions[1]);
+    free(partitions);
+    groups->foreach_l(groups, (Foreach) function(void, (List *item) {
+        item->free(item);
+    }));
+    groups->free(groups);
+    list->free(list);
+}
+
+MU_TEST(test_batch)
+{
+    int items[10], i;
+    void *pointers[10], *out[10];
+    List *list = list_new(), *taken, *sized = list_new_sized(sizeof(int));
+
+    for (i = 0; i < 10; i++) {
+        items[i] = i;
+        pointers[i] = &items[i];
+    }
+    list->append_n(list, pointers + 5, 5)->prepend_n(list, pointers, 5)->append_n(list, pointers, 0);
+    mu_assert_int_eq(10, list->count);
+    mu_assert_int_eq(0, *(int *) list->head(list));
+    mu_assert_int_eq(5, *(int *) list->get(list, 5));
+    mu_assert_int_eq(4, *(int *) list->get(list, -6));
+
+    mu_assert_int_eq(3, list->shift_n(list, out, 3));
+    mu_assert_int_eq(2, *(int *) out[2]);
+    mu_assert_int_eq(2, list->pop_n(list, out, 2));
+    mu_assert_int_eq(9, *(int *) out[0]);
+    mu_assert_int_eq(8, *(int *) out[1]);
+    mu_assert_int_eq(5, list->count);
+    mu_assert_int_eq(3, *(int *) list->head(list));
+    mu_assert_int_eq(7, *(int *) list->last(list));
+
+    taken = list->take_all(list);
+    mu_assert_int_eq(0, list->count);
+    mu_assert(NULL == list->head(list), "Should be empty");
+    mu_assert_int_eq(5, taken->count);
+    mu_assert_int_eq(5, taken->pop_n(taken, out, 10));
+    mu_assert_int_eq(3, *(int *) out[4]);
+    mu_assert(NULL == taken->last(taken), "Should be empty");
+
+    /** The inline items are valid until the next change */
+    sized->append(sized, &items[0])->append_copy(sized, &items[1])->append(sized, &items[2]);
+    sized->append_copy(sized, &items[3]);
+    mu_assert_int_eq(2, sized->shift_n(sized, out, 2));
+    mu_assert_int_eq(0, *(int *) out[0]);
+    mu_assert_int_eq(1, *(int *) out[1]);
+    mu_assert(&items[1] != out[1], "Should be the inline copy");
+    mu_assert_int_eq(2, sized->pop_n(sized, out, 3));
+    mu_assert_int_eq(3, *(int *) out[0]);
+    mu_assert_int_eq(2, *(int *) out[1]);
+    mu_assert_int_eq(0, sized->count);
+    mu_assert_int_eq(0, sized->shift_n(sized, out, 3));
+
+    sized->free(sized);
+    taken->free(taken);
+    list->free(list);
+}
+
+MU_TEST(test_reverse_rotate)
+{
+    int items[6], i, sum = 0;
+    List *list = list_new(), *copy;
+    Node *handle = NULL;
+    Fold digits = (Fold) function(int *, (int *total, int *item) {
+        *total = *total * 10 + *item;
+        return total;
+    });
+
+    for (i = 0; i < 6; i++) {
+        items[i] = i;
+        if (5 == i) {
+            handle = list->append_h(list, &items[i]);
+        } else {
+            list->append(list, &items[i]);
+        }
+    }
+
+    list->reverse(list);
+    mu_assert_int_eq(5, *(int *) list->head(list));
+    mu_assert_int_eq(0, *(int *) list->last(list));
+    mu_assert_int_eq(2, *(int *) list->get(list, 3));
+    list->move_to_back(list, handle);
+    mu_assert_int_eq(4, *(int *) list->head(list));
+    mu_assert_int_eq(5, *(int *) list->last(list));
+    mu_assert_int_eq(6, list->count);
+    list->move_to_front(list, handle);
+    list->reverse(list);
+
+    copy = list->clone_cow(list);
+    list->rotate(list, 2);
+    mu_assert_int_eq(0, *(int *) copy->head(copy));
+    mu_assert_int_eq(2, *(int *) list->head(list));
+    mu_assert_int_eq(1, *(int *) list->last(list));
+    mu_assert_int_eq(0, *(int *) list->get(list, -2));
+    list->rotate(list, -14);
+    mu_assert_int_eq(0, *(int *) list->head(list));
+    list->rotate(list, 5)->rotate(list, 1)->rotate(list, 0);
+    mu_assert_int_eq(0, *(int *) list->head(list));
+    mu_assert_int_eq(5, *(int *) list->last(list));
+    list->fold_l(list, &sum, digits);
+    mu_assert_int_eq(12345, sum);
+    sum = 0;
+    list->fold_r(list, &sum, digits);
+    mu_assert_int_eq(543210, sum);
+
+    list->flags |= LIST_REVERSED;
+    mu_assert_int_eq(5, *(int *) list->head(list));
+    mu_assert_int_eq(0, *(int *) list->last(list));
+    mu_assert_int_eq(4, *(int *) list->get(list, 1));
+    mu_assert_int_eq(1, *(int *) list->get(list, -2));
+    sum = 0;
+    list->fold_l(list, &sum, digits);
+    mu_assert_int_eq(543210, sum);
+    list->rotate(list, 1);
+    mu_assert_int_eq(4, *(int *) list->head(list));
+    mu_assert_int_eq(5, *(int *) list->last(list));
+    list->delete_at(list, 0);
+    mu_assert_int_eq(3, *(int *) list->head(list));
+
+    /** The ends agree with head and last: 3 2 1 0 5 is seen */
+    mu_assert_int_eq(3, *(int *) list->shift(list));
+    mu_assert_int_eq(5, *(int *) list->pop(list));
+    list->prepend(list, &items[4]);
+    list->append(list, &items[5]);
+    mu_assert_int_eq(4, *(int *) list->head(list));
+    mu_assert_int_eq(5, *(int *) list->last(list));
+    mu_assert_int_eq(2, *(int *) list->get(list, 1));
+    list->prepend_n(list, (void *[]) {&items[0], &items[1]}, 2);
+    mu_assert_int_eq(0, *(int *) list->head(list));
+    mu_assert_int_eq(1, *(int *) list->get(list, 1));
+    handle = list->prepend_h(list, &items[5]);
+    mu_assert_int_eq(5, *(int *) list->head(list));
+    list->move_to_back(list, handle);
+    mu_assert_int_eq(5, *(int *) list->last(list));
+    mu_assert_int_eq(0, *(int *) list->head(list));
+    list_adapt(list, &(ListTuning) {1, 0, 0, 1, NULL});
+    list->get(list, 0);
+    mu_assert(list_mode(list) & LIST_MODE_INDEXED, "Should be indexed");
+    mu_assert_int_eq(0, *(int *) list->shift(list));
+    mu_assert_int_eq(5, *(int *) list->pop(list));
+    list->append(list, &items[3]);
+    mu_assert_int_eq(1, *(int *) list->get(list, 0));
+    mu_assert_int_eq(3, *(int *) list->get(list, -1));
+    mu_assert_int_eq(5, *(int *) list->get(list, -2));
+    list->flags &= ~LIST_REVERSED;
+    mu_assert_int_eq(3, *(int *) list->head(list));
+    mu_assert_int_eq(1, *(int *) list->last(list));
+    mu_assert_int_eq(7, list->count);
+
+    copy->free(copy);
+    list->free(list);
+}
+
+MU_TEST(test_view)
+{
+    int items[10], i, sum = 0;
+    List *list = list_new(), *tail;
+    ListView view;
+
+    for (i = 0; i < 10; i++) {
+        items[i] = i;
+        list->append(list, &items[i]);
+    }
+    view = list->slice(list, 2, -3);
+    mu_assert_int_eq(5, view.count);
+    mu_assert_int_eq(2, *(int *) list_node_value(view.first));
+    mu_assert_int_eq(6, *(int *) list_node_value(view.last));
+    view.fold_r(&view, &sum, function(void *, (void *total, void *item) {
+        *(int *) total += *(int *) item;
+        return total;
+    }));
+    mu_assert_int_eq(20, sum);
+    mu_assert(!view.exists(&view, (Predicate) function(bool, (int *item) {
+        return 7 == *item;
+    })), "Should be out of the view");
+    mu_assert_int_eq(5, *(int *) view.find(&view, (Predicate) function(bool, (int *item) {
+        return *item > 4;
+    })));
+
+    view = list->take(list, 3);
+    mu_assert_int_eq(3, view.count);
+    mu_assert_int_eq(2, *(int *) list_node_value(view.last));
+    view = list->skip(list, 8);
+    mu_assert_int_eq(2, view.count);
+    mu_assert_int_eq(8, *(int *) list_node_value(view.first));
+    view = list->slice(list, 7, 3);
+    mu_assert_int_eq(0, view.count);
+    mu_assert(NULL == view.find(&view, (Predicate) function(bool, (void *item) {
+        return NULL != item;
+    })), "Should be empty");
+
+    tail = list->split_at(list, -4);
+    mu_assert_int_eq(6, list->count);
+    mu_assert_int_eq(4, tail->count);
+    mu_assert_int_eq(5, *(int *) list->last(list));
+    mu_assert_int_eq(6, *(int *) tail->head(tail));
+    mu_assert_int_eq(9, *(int *) tail->get(tail, -1));
+    tail->free(tail);
+
+    tail = list->split_at(list, 0);
+    mu_assert_int_eq(0, list->count);
+    mu_assert(NULL == list->last(list), "Should be empty");
+    mu_assert_int_eq(6, tail->count);
+    tail->free(tail);
+    list->free(list);
+}
+
+static unsigned MIGRATIONS = 0;
+
+MU_TEST(test_adaptive)
+{
+    int items[200], i, matching = 0, found = 0;
+    ListTuning tuning = {64, 16, 0.25, 0.25, NULL};
+    List *list = list_new();
+
+    tuning.on_migrate = function(void, (List *migrated, unsigned from, unsigned to) {
+        (void) migrated;
+        (void) from;
+        (void) to;
+        MIGRATIONS++;
+    });
+    list_adapt(list, &tuning);
+    for (i = 0; i < 100; i++) {
+        items[i] = i;
+        list->append(list, &items[i]);
+    }
+    mu_assert_int_eq(LIST_MODE_LINKED, list_mode(list));
+
+    for (i = 0; i < 200; i++) {
+        matching += i % 100 == *(int *) list->get(list, i % 100);
+    }
+    mu_assert_int_eq(200, matching);
+    mu_assert_int_eq(LIST_MODE_INDEXED, list_mode(list));
+    mu_assert_int_eq(1, MIGRATIONS);
+
+    items[100] = 100;
+    items[101] = -1;
+    list->prepend(list, &items[101])->append(list, &items[100]);
+    mu_assert_int_eq(-1, *(int *) list->get(list, 0));
+    mu_assert_int_eq(100, *(int *) list->get(list, -1));
+    list->shift(list);
+    list->pop(list);
+    list->delete(list, &items[50]);
+    list->set(list, 50, &items[100]);
+    mu_assert_int_eq(0, *(int *) list->get(list, 0));
+    mu_assert_int_eq(100, *(int *) list->get(list, 50));
+    mu_assert_int_eq(52, *(int *) list->get(list, 51));
+    mu_assert(NULL == list->get(list, 99), "Should be out of bounds");
+
+    for (i = 0; i < 200; i++) {
+        found += list->has(list, &items[i % 101]);
+    }
+    mu_assert_int_eq(LIST_MODE_HASHED, list_mode(list));
+    mu_assert_int_eq(196, found);
+    list->shift(list);
+    list->append(list, &items[150]);
+    mu_assert(!list->has(list, &items[0]), "Should be shifted");
+    mu_assert(list->has(list, &items[150]), "Should be appended");
+
+    for (i = 0; i < 200; i++) {
+        list->append(list, &items[i]);
+        list->shift(list);
+    }
+    mu_assert_int_eq(LIST_MODE_LINKED, list_mode(list));
+    mu_assert_int_eq(99, list->count);
+    mu_assert(&items[101] == list->head(list), "Should be shifted in order");
+    mu_assert_int_eq(3, MIGRATIONS);
+
+    list->free(list);
+}
+
+static size_t NODE_ALLOCATIONS = 0;
+
+static void *counting_alloc(size_t size)
+{
+    NODE_ALLOCATIONS++;
+
+    return malloc(size);
+}
+
+MU_TEST(test_embedded)
+{
+    int a = 1, b = 2;
+    List embedded, *list, *copy;
+    struct {
+        int id;
+        List items;
+    } owner;
+
+    list_init(&embedded)->append(&embedded, &a)->append(&embedded, &b);
+    mu_assert_int_eq(2, embedded.count);
+    embedded.free(&embedded);
+    mu_assert_int_eq(0, embedded.count);
+    embedded.prepend(&embedded, &b);
+    mu_assert_int_eq(2, *(int *) embedded.head(&embedded));
+    list_destroy(&embedded);
+
+    /** Destroying an adaptive List leaves a plain one */
+    list_adapt(&embedded, NULL);
+    embedded.append(&embedded, &a);
+    list_destroy(&embedded);
+    embedded.append(&embedded, &b)->prepend(&embedded, &a);
+    mu_assert_int_eq(2, *(int *) embedded.get(&embedded, 1));
+    mu_assert(embedded.has(&embedded, &a), "Should have");
+    mu_assert_int_eq(LIST_MODE_LINKED, list_mode(&embedded));
+    list_destroy(&embedded);
+
+    owner.id = 1;
+    list_init(&owner.items);
+    owner.items.release_item = free;
+    list = list_new();
+    list->append(list, malloc(sizeof(int)));
+    owner.items.append(&owner.items, malloc(sizeof(int)))->concat_f(&owner.items, list);
+    mu_assert_int_eq(2, owner.items.count);
+    owner.items.delete_at(&owner.items, 0);
+    list_destroy(&owner.items);
+
+    list = list_new();
+    list->free(list);
+    mu_assert(list == list_new(), "Should reuse the pooled header");
+    list->alloc_node = counting_alloc;
+    list->append(list, &a)->append(list, &b);
+    copy = list->clone(list);
+    mu_assert(counting_alloc == copy->alloc_node, "Should keep the allocator");
+    mu_assert_int_eq(4, NODE_ALLOCATIONS);
+    copy->free(copy);
+    list->free(list);
+    list_header_trim();
+}
+
 MU_TEST(test_filter)
 {
     List *list = list_new();
@@ -383,6 +956,888 @@ MU_TEST(test_allocators)
     list->free(list);
     mu_assert_int_eq(2, NODE_RELEASE_INVOKED);
     mu_assert_int_eq(2, ITEM_RELEASE_INVOKED);
+
+    list_set_allocators(NULL, NULL, NULL);
+}
+
+MU_TEST(test_handles)
+{
+    int a = 1, b = 2, c = 3;
+    char order[10] = "";
+    List *list = list_new();
+
+    Node *first = list->append_h(list, &a);
+    Node *second = list->append_h(list, &b);
+    Node *third = list->prepend_h(list, &c);
+
+    mu_assert_int_eq(2, *(int *) list_node_value(second));
+
+    list
+        ->move_to_front(list, second)
+        ->move_to_back(list, third)
+        ->foreach_l(list, (Foreach) function(void, (int *item) {
+            sprintf(order + strlen(order), "%d", *item);
+        }));
+    mu_assert_int_eq(0, strcmp("213", order));
+
+    list->move_before(list, third, second);
+    mu_assert_int_eq(3, *(int *) list->head(list));
+    mu_assert_int_eq(1, *(int *) list->last(list));
+
+    list->move_before(list, third, NULL);
+    mu_assert_int_eq(3, *(int *) list->last(list));
+
+    mu_assert_int_eq(1, *(int *) list->remove_h(list, first));
+    mu_assert_int_eq(2, list->count);
+    mu_assert_int_eq(2, *(int *) list->head(list));
+    mu_assert_int_eq(3, *(int *) list->get(list, 1));
+
+    list->free(list);
+}
+
+static void *fill_cached_list(void *list)
+{
+    int i;
+
+    for (i = 0; i < 1000; i++) {
+        ((List *) list)->append(list, NULL);
+    }
+
+    return list;
+}
+
+MU_TEST(test_node_cache)
+{
+    pthread_t threads[4];
+    List *lists[4];
+    int i;
+
+    list_set_allocators(node_cache_alloc, node_cache_release, NULL);
+
+    for (i = 0; i < 4; i++) {
+        lists[i] = list_new();
+        pthread_create(&threads[i], NULL, fill_cached_list, lists[i]);
+    }
+    for (i = 0; i < 4; i++) {
+        pthread_join(threads[i], NULL);
+        mu_assert_int_eq(1000, lists[i]->count);
+        /** Released on a different thread, than the one the nodes were allocated on */
+        lists[i]->free(lists[i]);
+    }
+
+    lists[0] = list_new();
+    fill_cached_list(lists[0]);
+    lists[0]->delete_at(lists[0], 0)->delete_at(lists[0], -1);
+    mu_assert_int_eq(998, lists[0]->count);
+    lists[0]->free(lists[0]);
+
+    node_cache_trim();
+    list_set_allocators(NULL, NULL, NULL);
+}
+
+MU_TEST(test_compact_list)
+{
+    int items[100], i, sum = 0;
+    CompactList *list = compact_list_new();
+
+    for (i = 0; i < 100; i++) {
+        items[i] = i;
+        list->append(list, &items[i]);
+    }
+    mu_assert_int_eq(100, list->count);
+    mu_assert_int_eq(0, *(int *) list->head(list));
+    mu_assert_int_eq(99, *(int *) list->last(list));
+    mu_assert_int_eq(70, *(int *) list->get(list, 70));
+    mu_assert_int_eq(98, *(int *) list->get(list, -2));
+    mu_assert(NULL == list->get(list, 100), "Out of bounds");
+
+    list->filter(list, (Predicate) function(bool, (int *item) {
+        return 0 == *item % 2;
+    }));
+    mu_assert_int_eq(50, list->count);
+
+    list->shift(list);
+    list->pop(list);
+    list->delete(list, &items[50])->delete_at(list, 0);
+    mu_assert_int_eq(46, list->count);
+    mu_assert_int_eq(4, *(int *) list->head(list));
+
+    list->prepend(list, &items[1])->set(list, -1, &items[3]);
+    mu_assert(list->has(list, &items[1]), "Should have");
+    mu_assert_int_eq(3, *(int *) list->last(list));
+    mu_assert(list->used <= 100, "Released slots should be recycled");
+
+    sum = *(int *) list->fold_r(list, &sum, function(void *, (void *val, void *item) {
+        *(int *) val += *(int *) item;
+        return val;
+    }));
+    mu_assert_int_eq(2208, sum);
+
+    list->free(list);
+
+    /** Every index is used, so nothing can be added */
+    list = compact_list_new();
+    list->used = COMPACT_NIL;
+    list->append(list, &items[0])->prepend(list, &items[1]);
+    mu_assert_int_eq(0, list->count);
+    mu_assert(NULL == list->head(list), "Should be full");
+    list->free(list);
+}
+
+typedef struct {
+    int x;
+    int y;
+} Point;
+
+MU_TEST(test_sized)
+{
+    Point point = {1, 2}, removed;
+    List *list = list_new_sized(sizeof(Point));
+    list->release_item = free;
+
+    list->append_copy(list, &point);
+    point.x = 3;
+    list->prepend_copy(list, &point);
+    list->append(list, malloc(sizeof(Point)));
+
+    mu_assert_int_eq(3, list->count);
+    mu_assert_int_eq(3, ((Point *) list->head(list))->x);
+    mu_assert_int_eq(1, ((Point *) list->get(list, 1))->x);
+    mu_assert(&point != list->head(list), "Should be a copy");
+
+    List *copy = list->clone(list);
+    copy->release_item = NULL;
+    ((Point *) copy->head(copy))->x = 10;
+    mu_assert_int_eq(3, ((Point *) list->head(list))->x);
+    mu_assert(list->last(list) == copy->last(copy), "Not inline items are shared");
+
+    list->delete_at(list, 0);
+    mu_assert_int_eq(1, ((Point *) list->find(list, (Predicate) function(bool, (Point *item) {
+        return 2 == item->y;
+    })))->x);
+
+    /** A removed inline item is valid until the next change, the copies are read after their nodes are gone */
+    list->prepend_copy(list, &point);
+    mu_assert_int_eq(3, ((Point *) list->shift(list))->x);
+    mu_assert_int_eq(2, list->count);
+    list->prepend_copy(list, &point);
+    mu_assert(list->shift_copy(list, &removed), "Should be removed");
+    mu_assert_int_eq(3, removed.x);
+    mu_assert_int_eq(2, list->count);
+    ((Point *) list->last(list))->x = 7;
+    mu_assert(list->pop_copy(list, &removed), "Should be removed");
+    mu_assert_int_eq(7, removed.x);
+    mu_assert(list->pop_copy(list, &removed), "Should be removed");
+    mu_assert_int_eq(1, removed.x);
+    mu_assert(!list->pop_copy(list, &removed), "Should be empty");
+
+    list->append_copy(list, &point)->append_copy(list, &point);
+    while (list->count) {
+        mu_assert_int_eq(3, ((Point *) list->pop(list))->x);
+    }
+    list->append_copy(list, &point);
+    mu_assert_int_eq(3, ((Point *) list->remove_h(list, list->head_node))->x);
+    mu_assert(NULL == list->head(list), "Should be removed");
+
+    copy->free(copy);
+    list->free(list);
+}
+
+static size_t LARGEST_NODE_REQUEST = 0;
+
+MU_TEST(test_compact)
+{
+    int items[200], i;
+    Point point = {1, 2}, removed, *held;
+    List *list = list_new(), *snapshot, *groups, *sized = list_new_sized(sizeof(Point));
+
+    for (i = 0; i < 200; i++) {
+        items[i] = i;
+        list->append(list, &items[i]);
+    }
+    list->filter(list, (Predicate) function(bool, (int *item) {
+        return *item % 2;
+    }));
+    list->compact(list);
+    mu_assert_int_eq(100, list->count);
+    mu_assert_int_eq(1, *(int *) list->head(list));
+    mu_assert_int_eq(199, *(int *) list->last(list));
+    mu_assert_int_eq(3, *(int *) list->get(list, -99));
+    mu_assert_double_eq(0, list->fragmentation(list));
+
+    snapshot = list->clone_cow(list);
+    list->shift(list);
+    list->compact(list);
+    mu_assert_int_eq(99, list->count);
+    mu_assert_int_eq(100, snapshot->count);
+    mu_assert_int_eq(199, *(int *) snapshot->last(snapshot));
+    list->free(list);
+
+    snapshot->compact(snapshot);
+    groups = snapshot->group_by(snapshot, (Key) function(void *, (int *item) {
+        return (void *) (uintptr_t) (*item % 4);
+    }), NULL, NULL);
+    mu_assert_int_eq(2, groups->count);
+    snapshot->free(snapshot);
+    groups->foreach_l(groups, (Foreach) function(void, (List *item) {
+        item->delete_at(item, 0);
+        item->free(item);
+    }));
+    groups->free(groups);
+
+    sized->flags |= LIST_AUTO_COMPACT;
+    for (i = 0; i < 200; i++) {
+        point.x = i;
+        sized->append_copy(sized, &point);
+    }
+    sized->compact(sized);
+    for (i = 0; i < 140; i++) {
+        sized->append_copy(sized, &point);
+        sized->shift_copy(sized, &removed);
+        sized->pop_copy(sized, &removed);
+    }
+    mu_assert_int_eq(60, sized->count);
+    mu_assert_int_eq(140, ((Point *) sized->head(sized))->x);
+    mu_assert_double_eq(0, sized->fragmentation(sized));
+
+    /** The removed inline items stay valid, even if the List compacts, or leaves the block to a snapshot */
+    for (i = 0; i < 60; i++) {
+        held = sized->shift(sized);
+        if (30 == i) {
+            snapshot = sized->clone_cow(sized);
+        }
+        mu_assert_int_eq(140 + i, held->x);
+    }
+    snapshot->free(snapshot);
+    sized->free(sized);
+
+    /** The block doesn't come from the node allocator, that may only serve node sized requests */
+    list = list_new();
+    list->alloc_node = (Alloc) function(void *, (size_t size) {
+        LARGEST_NODE_REQUEST = size > LARGEST_NODE_REQUEST ? size : LARGEST_NODE_REQUEST;
+        return malloc(size);
+    });
+    for (i = 0; i < 100; i++) {
+        list->append(list, &items[i]);
+    }
+    list->compact(list)->shift(list);
+    mu_assert_int_eq(list_node_size(), LARGEST_NODE_REQUEST);
+    list->free(list);
+}
+
+MU_TEST(test_prefetch_items)
+{
+    int items[20], i, sum = 0;
+    List *list = list_new();
+    list->flags |= LIST_PREFETCH_ITEMS;
+
+    for (i = 0; i < 20; i++) {
+        items[i] = i;
+        list->append(list, &items[i]);
+    }
+    list->filter(list, (Predicate) function(bool, (int *item) {
+        return *item >= 10;
+    }));
+    list->fold_r(list, &sum, function(void *, (void *val, void *item) {
+        *(int *) val += *(int *) item;
+        return val;
+    }));
+
+    mu_assert_int_eq(145, sum);
+    mu_assert_int_eq(19, *(int *) list->find(list, (Predicate) function(bool, (int *item) {
+        return 19 == *item;
+    })));
+
+    list->free(list);
+}
+
+
+LIST_DEFINE(int_list, int)
+LIST_DEFINE(point_list, Point)
+
+static int add_int(int a, int b)
+{
+    return a + b;
+}
+
+static bool is_odd(int *item)
+{
+    return *item % 2;
+}
+
+MU_TEST(test_typed_list)
+{
+    int i, value = 0;
+    int_list *list = int_list_new();
+    point_list points;
+    Point point = {1, 2};
+
+    for (i = 1; i <= 10; i++) {
+        int_list_append(list, i);
+    }
+    int_list_prepend(list, 0);
+
+    mu_assert_int_eq(11, list->count);
+    mu_assert_int_eq(55, int_list_fold_l(list, 0, add_int));
+    mu_assert_int_eq(9, *int_list_get(list, -2));
+    mu_assert(NULL == int_list_get(list, 11), "Out of bounds");
+
+    int_list_set(int_list_filter(list, is_odd), 0, 100);
+    mu_assert_int_eq(5, list->count);
+    mu_assert_int_eq(100, *int_list_head(list));
+    mu_assert(int_list_pop(list, &value), "Should pop");
+    mu_assert_int_eq(9, value);
+    mu_assert_int_eq(7, *int_list_last(list));
+    int_list_free(list);
+
+    point_list_init(&points);
+    point_list_append(&points, point);
+    point.x = 10;
+    point_list_prepend(&points, point);
+    mu_assert_int_eq(10, point_list_head(&points)->x);
+    mu_assert_int_eq(1, point_list_get(&points, 1)->x);
+    mu_assert(point_list_shift(&points, &point), "Should shift");
+    mu_assert_int_eq(1, points.count);
+    point_list_clear(&points);
+    mu_assert(false == point_list_shift(&points, NULL), "Should be empty");
+}
+
+static size_t RELEASED_ITEMS = 0;
+static size_t RELEASED_NODES = 0;
+static size_t RELEASE_BATCHES = 0;
+
+static void release_items(void **items, size_t count)
+{
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        free(items[i]);
+    }
+    __sync_fetch_and_add(&RELEASED_ITEMS, count);
+    __sync_fetch_and_add(&RELEASE_BATCHES, 1);
+}
+
+static void release_nodes(void **nodes, size_t count)
+{
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        free(nodes[i]);
+    }
+    __sync_fetch_and_add(&RELEASED_NODES, count);
+}
+
+static List *list_of_allocated(size_t count)
+{
+    List *list = list_new();
+    list->release_item = free;
+
+    while (count--) {
+        list->append(list, malloc(sizeof(int)));
+    }
+
+    return list;
+}
+
+MU_TEST(test_reclaimer)
+{
+    Reclaimer *reclaimer = reclaimer_new(release_items, release_nodes, 100, false);
+    List *list = list_of_allocated(250);
+    list->reclaimer = reclaimer;
+
+    list->shift(list);
+    list->delete_at(list, 0);
+    list->filter(list, (Predicate) function(bool, (void *item) {
+        (void) item;
+        return false;
+    }));
+    mu_assert_int_eq(0, list->count);
+    mu_assert_int_eq(200, RELEASED_ITEMS);
+    mu_assert_int_eq(2, RELEASE_BATCHES);
+
+    list->free(list);
+    reclaimer->flush(reclaimer);
+    mu_assert_int_eq(250, RELEASED_ITEMS);
+    mu_assert_int_eq(250, RELEASED_NODES);
+    reclaimer->free(reclaimer);
+
+    reclaimer = reclaimer_new(release_items, NULL, 64, true);
+    list = list_of_allocated(1000);
+    list->reclaimer = reclaimer;
+    list->free(list);
+    reclaimer->free(reclaimer);
+    mu_assert_int_eq(1250, RELEASED_ITEMS);
+    mu_assert_int_eq(250, RELEASED_NODES);
+}
+
+static int compare_ints(void *a, void *b)
+{
+    return *(int *) a - *(int *) b;
+}
+
+/** Also checks the stability, the items of the array were appended in order */
+static bool is_sorted(List *list, int *items, size_t count)
+{
+    int *prev = NULL;
+    size_t seen = 0;
+
+    bool unordered = list->exists(list, (Predicate) function(bool, (int *item) {
+        bool wrong = prev && (*prev > *item || (*prev == *item && prev > item));
+        prev = item;
+        seen++;
+        return wrong;
+    }));
+    prev = NULL;
+    list->foreach_r(list, (Foreach) function(void, (int *item) {
+        unordered |= prev && *prev < *item;
+        prev = item;
+    }));
+
+    return !unordered && seen == count && list->count == count && prev == list->head(list)
+           && items <= prev && prev < items + count;
+}
+
+MU_TEST(test_sort)
+{
+    int items[100000], i;
+    List *list = list_new();
+
+    list->sort(list, compare_ints)->par_sort(list, compare_ints, 4);
+    mu_assert(NULL == list->head(list), "Should be empty");
+
+    srand(1);
+    for (i = 0; i < 100000; i++) {
+        items[i] = rand() % 1000;
+    }
+    for (i = 0; i < 1000; i++) {
+        list->append(list, &items[i]);
+    }
+    list->sort(list, compare_ints);
+    mu_assert(is_sorted(list, items, 1000), "Should be sorted");
+    list->free(list);
+
+    list = list_new();
+    for (i = 0; i < 100000; i++) {
+        list->append(list, &items[i]);
+    }
+    list->par_sort(list, compare_ints, 3);
+    mu_assert(is_sorted(list, items, 100000), "Should be sorted in parallel");
+    list->free(list);
+
+    /** At most one run per PARALLEL_THRESHOLD items, not 1000 threads */
+    list = list_new();
+    for (i = 0; i < 20000; i++) {
+        list->append(list, &items[i]);
+    }
+    list->par_sort(list, compare_ints, 1000);
+    mu_assert(is_sorted(list, items, 20000), "Should be sorted with too many threads");
+    list->free(list);
+
+    list = list_new();
+    list->sort_by_key(list, NULL);
+    for (i = 0; i < 100000; i++) {
+        list->append(list, &items[i]);
+    }
+    list->sort_by_key(list, (SortKey) function(uint64_t, (int *item) {
+        return 0xABCD000000000000ULL | (uint64_t) *item;
+    }));
+    mu_assert(is_sorted(list, items, 100000), "Should be sorted by the keys");
+    list->free(list);
+}
+
+MU_TEST(test_persistent_list)
+{
+    int items[1000], i;
+    char order[20] = "";
+    PersistentList *empty = persistent_list_new();
+    PersistentList *versions[1001], *changed, *deleted, *prepended;
+
+    versions[0] = empty;
+    for (i = 0; i < 1000; i++) {
+        items[i] = i;
+        versions[i + 1] = versions[i]->append(versions[i], &items[i]);
+    }
+    for (i = 0; i <= 1000; i += 250) {
+        mu_assert_int_eq(i, versions[i]->count);
+    }
+    mu_assert(NULL == empty->head(empty), "Should stay empty");
+    mu_assert_int_eq(499, *(int *) versions[500]->last(versions[500]));
+    mu_assert_int_eq(700, *(int *) versions[1000]->get(versions[1000], 700));
+    mu_assert_int_eq(998, *(int *) versions[1000]->get(versions[1000], -2));
+
+    changed = versions[1000]->set(versions[1000], 10, &items[0]);
+    mu_assert_int_eq(0, *(int *) changed->get(changed, 10));
+    mu_assert_int_eq(10, *(int *) versions[1000]->get(versions[1000], 10));
+
+    deleted = changed->delete_at(changed, 0);
+    prepended = deleted->prepend(deleted, &items[5]);
+    mu_assert_int_eq(999, deleted->count);
+    mu_assert_int_eq(1, *(int *) deleted->head(deleted));
+    mu_assert_int_eq(1000, prepended->count);
+    mu_assert_int_eq(5, *(int *) prepended->head(prepended));
+
+    for (i = 0; i < 1000; i++) {
+        mu_assert_int_eq(i, *(int *) versions[1000]->get(versions[1000], i));
+    }
+    for (i = 0; i <= 1000; i++) {
+        versions[i]->free(versions[i]);
+    }
+    mu_assert_int_eq(0, *(int *) changed->get(changed, 10));
+
+    versions[0] = persistent_list_new();
+    versions[1] = versions[0]->append(versions[0], &items[1]);
+    versions[2] = versions[1]->prepend(versions[1], &items[2]);
+    versions[3] = versions[2]->insert(versions[2], 1, &items[3]);
+    versions[3]->foreach_r(versions[3], (Foreach) function(void, (int *item) {
+        sprintf(order + strlen(order), "%d", *item);
+    }));
+    mu_assert_int_eq(0, strcmp("132", order));
+    mu_assert(versions[3]->exists(versions[3], (Predicate) function(bool, (int *item) {
+        return 3 == *item;
+    })), "Should exist");
+
+    changed->free(changed);
+    deleted->free(deleted);
+    prepended->free(prepended);
+    for (i = 0; i < 4; i++) {
+        versions[i]->free(versions[i]);
+    }
+}
+
+static bool RCU_DONE = false;
+
+static void *rcu_read(void *arg)
+{
+    RcuList *list = arg;
+    RcuReader *reader = list->register_reader(list);
+    long sum, reads = 0;
+
+    while (!__atomic_load_n(&RCU_DONE, __ATOMIC_ACQUIRE)) {
+        sum = 0;
+        list->fold_l(list, &sum, function(void *, (void *total, void *item) {
+            *(long *) total += *(int *) item;
+            return total;
+        }));
+        reads++;
+        rcu_quiescent(reader);
+    }
+    rcu_offline(reader);
+    list->unregister_reader(list, reader);
+
+    return (void *) reads;
+}
+
+/** A reader thread writing too, its reader is taken offline, so the writers don't wait for each other */
+static pthread_barrier_t RCU_WRITERS;
+
+static void *rcu_write(void *arg)
+{
+    RcuList *list = arg;
+    RcuReader *reader = list->register_reader(list);
+    static int item = 1;
+    int i;
+
+    pthread_barrier_wait(&RCU_WRITERS);
+    for (i = 0; i < 20000; i++) {
+        list->append(list, &item);
+        list->shift(list);
+        rcu_quiescent(reader);
+    }
+    list->unregister_reader(list, reader);
+
+    return NULL;
+}
+
+MU_TEST(test_rcu_list)
+{
+    pthread_t threads[3];
+    int i, *item, a = 1, b = 2;
+    RcuList *list = rcu_list_new();
+    RcuReader *reader = list->register_reader(list);
+    list->release_item = free;
+
+    for (i = 0; i < 3; i++) {
+        pthread_create(&threads[i], NULL, rcu_read, list);
+    }
+    for (i = 0; i < 2000; i++) {
+        item = malloc(sizeof(int));
+        *item = i;
+        list->append(list, item);
+        if (i % 2) {
+            list->delete(list, list->head(list));
+        }
+    }
+    __atomic_store_n(&RCU_DONE, true, __ATOMIC_RELEASE);
+    for (i = 0; i < 3; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    mu_assert_int_eq(1000, list->count);
+    mu_assert_int_eq(1000, *(int *) list->head(list));
+    list->unregister_reader(list, reader);
+    list->free(list);
+
+    list = rcu_list_new();
+    list->append(list, &a)->prepend(list, &b)->replace(list, &b, &a);
+    mu_assert(false == list->has(list, &b), "Should be replaced");
+    mu_assert_int_eq(1, *(int *) list->head(list));
+    list->delete(list, &a)->delete(list, &a);
+    mu_assert(NULL == list->head(list), "Should be empty");
+
+    list->append(list, &a)->append(list, &b);
+    mu_assert_int_eq(1, *(int *) list->shift(list));
+    mu_assert_int_eq(2, *(int *) list->shift(list));
+    mu_assert(NULL == list->shift(list), "Should be empty");
+    list->append(list, &a);
+    mu_assert_int_eq(1, *(int *) list->head(list));
+    list->free(list);
+
+    list = rcu_list_new();
+    pthread_barrier_init(&RCU_WRITERS, NULL, 2);
+    for (i = 0; i < 2; i++) {
+        pthread_create(&threads[i], NULL, rcu_write, list);
+    }
+    for (i = 0; i < 2; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_barrier_destroy(&RCU_WRITERS);
+    mu_assert_int_eq(0, list->count);
+    list->free(list);
+}
+
+#define WS_TASKS 20000
+
+static int WS_TAKEN[WS_TASKS];
+static bool WS_DONE = false;
+
+static void *ws_steal(void *arg)
+{
+    WsDeque *deque = arg;
+    int *task;
+
+    while (!__atomic_load_n(&WS_DONE, __ATOMIC_ACQUIRE) || deque->count(deque)) {
+        if ((task = deque->shift(deque))) {
+            __atomic_add_fetch(&WS_TAKEN[*task], 1, __ATOMIC_RELAXED);
+        }
+    }
+
+    return NULL;
+}
+
+MU_TEST(test_ws_deque)
+{
+    static int tasks[WS_TASKS];
+    pthread_t threads[3];
+    int i, a = 1, b = 2, c = 3, *task, wrong = 0;
+    WsDeque *deque = ws_deque_new(0);
+
+    deque->append(deque, &a)->append(deque, &b)->append(deque, &c);
+    mu_assert_int_eq(3, deque->count(deque));
+    mu_assert_int_eq(3, *(int *) deque->pop(deque));
+    mu_assert_int_eq(1, *(int *) deque->shift(deque));
+    mu_assert_int_eq(2, *(int *) deque->pop(deque));
+    mu_assert(NULL == deque->pop(deque), "Should be empty");
+    mu_assert(NULL == deque->shift(deque), "Should be empty");
+
+    for (i = 0; i < 3; i++) {
+        pthread_create(&threads[i], NULL, ws_steal, deque);
+    }
+    for (i = 0; i < WS_TASKS; i++) {
+        tasks[i] = i;
+        deque->append(deque, &tasks[i]);
+        if (i % 3 && (task = deque->pop(deque))) {
+            __atomic_add_fetch(&WS_TAKEN[*task], 1, __ATOMIC_RELAXED);
+        }
+    }
+    __atomic_store_n(&WS_DONE, true, __ATOMIC_RELEASE);
+    while ((task = deque->pop(deque))) {
+        __atomic_add_fetch(&WS_TAKEN[*task], 1, __ATOMIC_RELAXED);
+    }
+    for (i = 0; i < 3; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    for (i = 0; i < WS_TASKS; i++) {
+        wrong += 1 != WS_TAKEN[i];
+    }
+    mu_assert_int_eq(0, wrong);
+    deque->free(deque);
+}
+
+static void *queue_produce(void *arg)
+{
+    static int items[1000];
+    BlockingQueue *queue = arg;
+    int i;
+
+    for (i = 0; i < 1000; i++) {
+        items[i] = i;
+        queue->push(queue, &items[i], QUEUE_FOREVER);
+    }
+
+    return NULL;
+}
+
+static void *queue_produce_n(void *arg)
+{
+    static int items[1000];
+    void *pointers[1000];
+    BlockingQueue *queue = arg;
+    int i;
+
+    for (i = 0; i < 1000; i++) {
+        items[i] = i;
+        pointers[i] = &items[i];
+    }
+    for (i = 0; i < 1000; i += 100) {
+        queue->push_n(queue, pointers + i, 100, QUEUE_FOREVER);
+    }
+
+    return NULL;
+}
+
+static bool is_readable(int fd)
+{
+    struct pollfd poll_fd = {fd, POLLIN, 0};
+
+    return 1 == poll(&poll_fd, 1, 0);
+}
+
+MU_TEST(test_blocking_queue)
+{
+    pthread_t producer;
+    int i, a = 1, b = 2, ordered = 0;
+    size_t j, drained;
+    void *out[6];
+    char *item;
+    BlockingQueue *queue = blocking_queue_new(8);
+
+    mu_assert(NULL == queue->shift_wait(queue, 10), "Should time out");
+    mu_assert(!is_readable(queue->event_fd), "Should not be ready");
+
+    pthread_create(&producer, NULL, queue_produce, queue);
+    for (i = 0; i < 1000; i++) {
+        ordered += i == *(int *) queue->shift_wait(queue, QUEUE_FOREVER);
+    }
+    pthread_join(producer, NULL);
+    mu_assert_int_eq(1000, ordered);
+    mu_assert_int_eq(0, queue->count(queue));
+    queue->free(queue);
+
+    queue = blocking_queue_new(1);
+    mu_assert(queue->try_push(queue, &a), "Should have capacity");
+    mu_assert(is_readable(queue->event_fd), "Should be ready");
+    mu_assert(!queue->push(queue, &b, 10), "Should be full");
+    mu_assert_int_eq(1, *(int *) queue->try_shift(queue));
+    mu_assert(!is_readable(queue->event_fd), "Should not be ready");
+    mu_assert(NULL == queue->try_shift(queue), "Should be empty");
+    queue->free(queue);
+
+    queue = blocking_queue_new(4);
+    pthread_create(&producer, NULL, queue_produce_n, queue);
+    for (i = 0, ordered = 0; i < 1000;) {
+        drained = queue->drain(queue, out, 3, QUEUE_FOREVER);
+        for (j = 0; j < drained; j++, i++) {
+            ordered += i == *(int *) out[j];
+        }
+    }
+    pthread_join(producer, NULL);
+    mu_assert_int_eq(1000, ordered);
+    mu_assert_int_eq(0, queue->drain(queue, out, 3, 0));
+    mu_assert(!is_readable(queue->event_fd), "Should not be ready");
+    mu_assert_int_eq(4, queue->push_n(queue, out, 6, 0));
+    mu_assert(is_readable(queue->event_fd), "Should be ready");
+    queue->free(queue);
+
+    /** The consumer gets the item, it's not released by the queue */
+    list_set_allocators(NULL, NULL, free);
+    queue = blocking_queue_new(0);
+    queue->try_push(queue, strdup("Job"));
+    item = queue->shift_wait(queue, 0);
+    mu_assert_int_eq(0, strcmp("Job", item));
+    free(item);
+    queue->free(queue);
+    list_set_allocators(NULL, NULL, NULL);
+}
+
+MU_TEST(test_lru)
+{
+    int a = 1, b = 2, c = 3, d = 4;
+    LruCache *cache = lru_new(3);
+    List *snapshot;
+
+    cache
+        ->put(cache, "a", &a)
+        ->put(cache, "b", &b)
+        ->put(cache, "c", &c);
+
+    mu_assert_int_eq(3, cache->order->count);
+    mu_assert_int_eq(1, *(int *) cache->get(cache, "a"));
+
+    cache->put(cache, "d", &d);
+    mu_assert(false == cache->has(cache, "b"), "Least recently used should be evicted");
+    mu_assert_int_eq(3, cache->order->count);
+    mu_assert_int_eq(4, *(int *) cache->order->head(cache->order));
+    mu_assert_int_eq(3, *(int *) cache->order->last(cache->order));
+
+    mu_assert(cache->touch(cache, "c"), "Should be touched");
+    cache->evict(cache);
+    mu_assert(false == cache->has(cache, "a"), "Should be evicted");
+    mu_assert_int_eq(3, *(int *) cache->peek(cache, "c"));
+
+    cache->put(cache, "c", &a)->delete(cache, "d");
+    mu_assert_int_eq(1, cache->order->count);
+    mu_assert_int_eq(1, *(int *) cache->get(cache, "c"));
+    mu_assert(NULL == cache->get(cache, "d"), "Should be deleted");
+
+    cache->put(cache, "a", &a)->put(cache, "b", &b);
+    snapshot = cache->order->clone_cow(cache->order);
+    cache->get(cache, "c");
+    cache->put(cache, "d", &d)->delete(cache, "b");
+    mu_assert_int_eq(3, snapshot->count);
+    mu_assert_int_eq(2, *(int *) snapshot->head(snapshot));
+    mu_assert_int_eq(1, *(int *) snapshot->last(snapshot));
+    mu_assert_int_eq(2, cache->order->count);
+    mu_assert_int_eq(4, *(int *) cache->order->head(cache->order));
+    mu_assert_int_eq(1, *(int *) cache->get(cache, "c"));
+    snapshot->free(snapshot);
+    cache->evict(cache);
+    mu_assert(false == cache->has(cache, "d"), "Should be evicted");
+
+    cache->free(cache);
+}
+
+static size_t RELEASED_KEYS = 0;
+
+MU_TEST(test_lru_release)
+{
+    int i;
+    LruCache *cache = lru_new(100);
+    cache->release_item = free;
+
+    for (i = 0; i < 1000; i++) {
+        int *item = malloc(sizeof(int));
+        *item = i;
+        cache->put(cache, (void *) (uintptr_t) (i % 150), item);
+    }
+
+    mu_assert_int_eq(100, cache->order->count);
+    mu_assert_int_eq(999, *(int *) cache->get(cache, (void *) (uintptr_t) (999 % 150)));
+    mu_assert(NULL == cache->get(cache, (void *) (uintptr_t) (999 % 150 + 1)), "Should be evicted");
+
+    cache->free(cache);
+
+    /** An equal key passed again is released, the stored one is kept */
+    cache = lru_new(2);
+    cache->hash = hash_string;
+    cache->equals = strings_equal;
+    cache->release_key = (Release) function(void, (char *key) {
+        RELEASED_KEYS++;
+        free(key);
+    });
+    cache->put(cache, strdup("key"), &i)->put(cache, strdup("key"), &i);
+    mu_assert_int_eq(1, RELEASED_KEYS);
+    mu_assert_int_eq(1, cache->order->count);
+    cache->free(cache);
+    mu_assert_int_eq(2, RELEASED_KEYS);
 }
 
 int main(void)
@@ -395,14 +1850,38 @@ int main(void)
     MU_RUN_TEST(test_get_index);
     MU_RUN_TEST(test_fold);
     MU_RUN_TEST(test_clone);
+    MU_RUN_TEST(test_clone_reversed);
+    MU_RUN_TEST(test_clone_cow);
     MU_RUN_TEST(test_delete);
     MU_RUN_TEST(test_concat);
     MU_RUN_TEST(test_merge);
+    MU_RUN_TEST(test_set_operations);
+    MU_RUN_TEST(test_group_by);
+    MU_RUN_TEST(test_batch);
+    MU_RUN_TEST(test_view);
+    MU_RUN_TEST(test_reverse_rotate);
+    MU_RUN_TEST(test_adaptive);
+    MU_RUN_TEST(test_embedded);
     MU_RUN_TEST(test_filter);
     MU_RUN_TEST(test_exists);
     MU_RUN_TEST(test_free_item);
     MU_RUN_TEST(test_complex_op);
     MU_RUN_TEST(test_allocators);
+    MU_RUN_TEST(test_handles);
+    MU_RUN_TEST(test_node_cache);
+    MU_RUN_TEST(test_compact_list);
+    MU_RUN_TEST(test_sized);
+    MU_RUN_TEST(test_compact);
+    MU_RUN_TEST(test_prefetch_items);
+    MU_RUN_TEST(test_typed_list);
+    MU_RUN_TEST(test_reclaimer);
+    MU_RUN_TEST(test_sort);
+    MU_RUN_TEST(test_persistent_list);
+    MU_RUN_TEST(test_rcu_list);
+    MU_RUN_TEST(test_ws_deque);
+    MU_RUN_TEST(test_blocking_queue);
+    MU_RUN_TEST(test_lru);
+    MU_RUN_TEST(test_lru_release);
 
     MU_REPORT();
 